@@ -14,6 +14,19 @@ static inline void buffer_setup (buffer_t *buffer, void *data, size_t size)
     buffer->end  += size;
 }
 
+static inline void buffer_resize (buffer_t *buffer, size_t size)
+{
+    const size_t read  = buffer->read-buffer->data;
+    const size_t write = buffer->write-buffer->data;
+
+    assert(write<=size);
+
+    buffer->data  = safe_realloc(buffer->data, ALIGN(size));
+    buffer->read  = buffer->data+read;
+    buffer->write = buffer->data+write;
+    buffer->end   = buffer->data+size;
+}
+
 static inline void buffer_format (buffer_t *buffer)
 {
     buffer->write = buffer->data;
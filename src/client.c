@@ -8,6 +8,7 @@
 #include "pointer.h"
 
 #include "terminal.h"
+#include "worker.h"
 
 #include "auth-gss.h"
 #include "auth-ssl.h"
@@ -605,6 +606,7 @@ main_init(int argc, char **argv)
 #endif
 
     int delegate = 0;
+    unsigned threads = 0;
     option(opt_flag, &delegate, "delegate", "delegate user credentials");
     option(opt_int, &global.lock.key, "lock-key", "keycode used to lock/unlock the keyboard and mouse");
 
@@ -613,6 +615,7 @@ main_init(int argc, char **argv)
     option(opt_flag, &global.fullscreen, "fullscreen", NULL);
     option(opt_flag, &global.pixmap.enabled, "enable-pixmap", NULL);
     option(opt_flag, &global.direct_key, "direct-key", NULL);
+    option(opt_int, &threads, "threads", NULL);
 
 #ifndef NETIO_NO_SSL
     int print_cert = 0;
@@ -643,6 +646,7 @@ main_init(int argc, char **argv)
 
     common_init();
     socket_init();
+    worker_init(threads);
 
 #ifndef NETIO_NO_SSL
     openssl_init();
@@ -713,7 +717,8 @@ main(int argc, char **argv)
     main_init(argc, argv);
 
     while (running) {
-        socket_wait(global.core.netio.fd, SOCKET_WAIT_R, 1);
+        socket_wait(global.core.netio.fd,
+                    global.core.decode ? 0 : SOCKET_WAIT_R, 1);
 
         if (global.display)
             display_event();
@@ -760,7 +765,7 @@ main(int argc, char **argv)
 
             if ((core_received(&global.core, command_image_data)) ||
                 (core_received(&global.core, command_pointer) &&
-                 (!global.core.master)))
+                 (!global.core.master) && (!global.core.decode)))
                 image_update();
         }
 
@@ -7,11 +7,7 @@ static inline void byte_copy (void *dst, const void *src, size_t size)
     if (!dst || !src)
         return;
 
-    char *restrict d = dst;
-    const char *restrict s = src;
-
-    while (size--)
-        *d++ = *s++;
+    __builtin_memcpy(dst, src, size);
 }
 
 static inline void *byte_dup (const char *src, size_t size)
@@ -26,10 +22,7 @@ static inline void byte_set (void *dst, const char value, size_t size)
     if (!dst)
         return;
 
-    char *restrict d = dst;
-
-    while (size--)
-        *d++ = value;
+    __builtin_memset(dst, value, size);
 }
 
 static inline void byte_set_safe (void *dst, const char value, size_t size)
@@ -49,14 +42,7 @@ static inline int byte_cmp (const void *ba, const void *bb, size_t size)
     if (!ba || !bb || !size)
         return 1;
 
-    const char *restrict a = ba;
-    const char *restrict b = bb;
-
-    while (size--)
-        if (*a++!=*b++)
-            return 1;
-
-    return 0;
+    return !!__builtin_memcmp(ba, bb, size);
 }
 
 _pure_
@@ -19,10 +19,28 @@
 #define CONFIG_MASTER_TIMEOUT  200
 #define CONFIG_GRAB_TIMEOUT    30
 
+#define CONFIG_IMAGE_WINDOW    8
+#define CONFIG_IMAGE_LOWAT     128*1024
+#define CONFIG_IMAGE_LATENCY   16
+#define CONFIG_SOURCE_RECTS    8
+#define CONFIG_SCREEN_BUFFERS  2
+
 #define CONFIG_BUFFER_SIZE     32*1024
 
 #define CONFIG_QUALITY_MIN     3
 #define CONFIG_QUALITY_MAX     5
+#define CONFIG_QUALITY_RTT     20
+#define CONFIG_QUALITY_DOWN    250
+#define CONFIG_QUALITY_UP      2000
+
+#define CONFIG_SHARED_RESET    16
+
+#define CONFIG_BLOCK           2
+#define CONFIG_RUN             0
+#define CONFIG_TILE_CACHE      4*1024*1024
+
+#define CONFIG_MOVE_TILES      64
+#define CONFIG_MOVE_LINES      16
 
 #define CONFIG_KEY_PRIVATE    "key"
 #define CONFIG_KEY_ACCEPT     "accept"
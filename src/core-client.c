@@ -27,6 +27,7 @@ core_create(core_client_t *core, const char *host, const char *port)
 void
 core_delete(core_client_t *core)
 {
+    tycho_recv_wait(&core->tycho);
     tycho_delete(&core->tycho);
     netio_delete(&core->netio);
 
@@ -65,6 +66,21 @@ core_send_all(core_client_t *core)
     return 1;
 }
 
+static void
+core_decoded(core_client_t *core)
+{
+    if (!core->decode || tycho_recv_busy(&core->tycho))
+        return;
+
+    core->decode = 0;
+    core->recv.mask |= (1 << command_image_data);
+
+    core->send.timeout = 30;
+    core->send.time = 0;
+
+    core_send_image(core, core->image_stamp);
+}
+
 int
 core_recv_all(core_client_t *core)
 {
@@ -73,6 +89,8 @@ core_recv_all(core_client_t *core)
 
     core->recv.mask = 0;
 
+    core_decoded(core);
+
     while (1) {
         switch (core->recv.command) {
 
@@ -212,18 +230,33 @@ core_recv_all(core_client_t *core)
 
         case command_image:
             {
-                if (buffer_read_size(input) < 4)
+                if (core->decode)
+                    return 1;
+
+                if (buffer_read_size(input) < 14)
                     goto read_again;
 
                 core->size.w = buffer_read_16(input);
                 core->size.h = buffer_read_16(input);
 
+                const int reset = buffer_read(input);
+                const unsigned bands = buffer_read(input);
+                const unsigned coder = buffer_read(input);
+                const unsigned block = buffer_read(input);
+                const unsigned run = buffer_read(input);
+                const unsigned cache = buffer_read(input);
+
+                core->image_stamp = buffer_read_32(input);
+
                 if (core->size.w <= 0 || core->size.h <= 0) {
                     core->recv.command = command_stop; // XXX
                     continue;
                 }
 
-                tycho_setup(&core->tycho, core->size.w, core->size.h);
+                tycho_setup(&core->tycho, core->size.w, core->size.h, bands, coder, block, run, cache);
+
+                if (reset)
+                    tycho_reset(&core->tycho);
 
                 core->recv.command++;
             }
@@ -231,20 +264,28 @@ core_recv_all(core_client_t *core)
 
         case command_image_data:
             {
-                if (core->size.w != core->image.w ||
-                        core->size.h != core->image.h || !core->image.data) {
-                    return 1;
+                if (core->drop) {
+                    if (tycho_recv_skip(&core->tycho, input))
+                        goto read_again;
+                } else {
+                    if (core->size.w != core->image.w ||
+                            core->size.h != core->image.h || !core->image.data) {
+                        return 1;
+                    }
+
+                    if (tycho_recv_busy(NULL))
+                        return 1;
+
+                    if (tycho_recv_start(&core->tycho, input, &core->image))
+                        goto read_again;
                 }
 
-                if (tycho_recv(&core->tycho, input, &core->image))
-                    goto read_again;
-
-                core->send.timeout = 30;
-                core->send.time = 0;
+                core->decode = 1;
+                core->recv.command = command_next;
 
-                core_send(core, command_image);
+                core_decoded(core);
 
-                break;
+                continue;
             }
 
         case command_control:
@@ -289,9 +330,16 @@ core_recv_all(core_client_t *core)
         continue;
 
     read_again:
-        switch (netio_read(netio)) {
-        case 0:  return 0;
-        case -1: return 1;
+        {
+            const size_t size = buffer_read_size(input);
+            const int ret = netio_read(netio);
+
+            core->received += buffer_read_size(input) - size;
+
+            switch (ret) {
+            case 0:  return 0;
+            case -1: return 1;
+            }
         }
     }
 
@@ -330,6 +378,17 @@ core_send(core_client_t *core, command_t command)
     core_send_all(core);
 }
 
+void
+core_send_image(core_client_t *core, uint32_t stamp)
+{
+    buffer_t *const buffer = get_buffer(core, 5);
+
+    buffer_write(buffer, command_image);
+    buffer_write_32(buffer, stamp);
+
+    core_send_all(core);
+}
+
 void
 core_send_quality(core_client_t *core, unsigned min, unsigned max)
 {
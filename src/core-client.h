@@ -21,7 +21,11 @@ struct core_client {
         uint64_t timeout;
     } send;
 
-    uint64_t image_time;
+    uint32_t image_stamp;
+    int decode;
+    int drop;
+
+    uint64_t received;
 
     struct {
         int w, h;
@@ -62,6 +66,7 @@ int       core_create            (core_client_t *, const char *, const char *);
 void      core_delete            (core_client_t *);
 void      core_send              (core_client_t *, command_t);
 void      core_send_data         (core_client_t *, command_t, const void *, size_t);
+void      core_send_image        (core_client_t *, uint32_t);
 void      core_send_quality      (core_client_t *, unsigned, unsigned);
 void      core_send_resize       (core_client_t *, unsigned, unsigned);
 void      core_send_pointer      (core_client_t *, int, int, int);
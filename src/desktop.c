@@ -0,0 +1,268 @@
+#include "desktop.h"
+#include "common-static.h"
+
+static uint64_t seed = 159;
+
+uint32_t
+desktop_rand(void)
+{
+    const uint32_t a = ((seed >> 18u) ^ seed) >> 27u;
+    const uint32_t b = seed >> 59u;
+    seed = seed * 6364136223846793005ULL + 15726070495360670683ULL;
+    return (a >> b) | (a << ((-b) & 31));
+}
+
+static void
+area_set(desktop_area_t *area, int x, int y, int w, int h)
+{
+    area->x = x;
+    area->y = y;
+    area->w = w;
+    area->h = h;
+}
+
+static void
+area_add(desktop_area_t *area, int x, int y, int w, int h)
+{
+    const int x1 = MAX(area->x + area->w, x + w);
+    const int y1 = MAX(area->y + area->h, y + h);
+
+    area->x = MIN(area->x, x);
+    area->y = MIN(area->y, y);
+    area->w = x1 - area->x;
+    area->h = y1 - area->y;
+}
+
+void
+desktop_rect(image_info_t *image, int x, int y, int w, int h, uint32_t color)
+{
+    for (int j = MAX(y, 0); j < MIN(y + h, image->h); j++)
+        for (int i = MAX(x, 0); i < MIN(x + w, image->w); i++)
+            image->data[j * image->stride + i] = color;
+}
+
+static void
+draw_desktop(image_info_t *image, int x, int y, int w, int h)
+{
+    for (int j = MAX(y, 0); j < MIN(y + h, image->h); j++) {
+        const uint32_t c = 0x203050 + ((j * 64 / image->h) << 8) + (j * 96 / image->h);
+        for (int i = MAX(x, 0); i < MIN(x + w, image->w); i++)
+            image->data[j * image->stride + i] = c;
+    }
+}
+
+static void
+draw_glyph(image_info_t *image, int x, int y, uint32_t fg, uint32_t bg)
+{
+    desktop_rect(image, x, y, 8, 16, bg);
+
+    if (desktop_rand() % 6 == 0)
+        return;
+
+    for (int j = 3; j < 13; j++) {
+        const uint32_t bits = desktop_rand();
+        for (int i = 1; i < 7; i++)
+            if (bits & (3u << (2 * i)) && (bits >> (2 * i + 16)) & 1)
+                desktop_rect(image, x + i, y + j, 1, 1, fg);
+    }
+}
+
+void
+desktop_text(image_info_t *image, int x, int y, int w, int h, uint32_t fg, uint32_t bg)
+{
+    desktop_rect(image, x, y, w, h, bg);
+
+    for (int j = y; j + 16 <= y + h; j += 16) {
+        const int len = desktop_rand() % (w / 8);
+        for (int i = 0; i < len; i++)
+            draw_glyph(image, x + i * 8, j, fg, bg);
+    }
+}
+
+static void
+draw_window(image_info_t *image, int x, int y, int w, int h)
+{
+    desktop_rect(image, x, y, w, 24, 0x3c3c3c);
+    desktop_rect(image, x + w - 20, y + 4, 16, 16, 0xc04040);
+    desktop_text(image, x, y + 24, w, h - 24, 0x202020, 0xf8f8f8);
+}
+
+static void
+draw_typing(image_info_t *image, int i, desktop_area_t *area)
+{
+    const int x = 48, y = 48;
+    const int cols = (image->w - 96) / 8;
+    const int rows = (image->h - 96) / 16;
+
+    if (!i) {
+        draw_desktop(image, 0, 0, image->w, image->h);
+        desktop_text(image, x, y, cols * 8, rows / 2 * 16, 0xd0d0d0, 0x1e1e1e);
+        desktop_rect(image, x, y + rows / 2 * 16, cols * 8, (rows - rows / 2) * 16, 0x1e1e1e);
+        area_set(area, 0, 0, image->w, image->h);
+        return;
+    }
+
+    const int k = i - 1;
+    const int cx = x + (k % cols) * 8;
+    const int cy = y + (rows / 2 + k / cols % (rows - rows / 2)) * 16;
+
+    draw_glyph(image, cx, cy, 0xd0d0d0, 0x1e1e1e);
+    desktop_rect(image, cx + 8, cy, 8, 16, 0xd0d0d0);
+    area_set(area, cx, cy, 16, 16);
+}
+
+static void
+draw_scroll(image_info_t *image, int i, desktop_area_t *area)
+{
+    const int x = 64, y = 64;
+    const int w = image->w - 128;
+    const int h = (image->h - 128) / 16 * 16;
+
+    if (!i) {
+        draw_desktop(image, 0, 0, image->w, image->h);
+        draw_window(image, x, y - 24, w, h + 24);
+        area_set(area, 0, 0, image->w, image->h);
+        return;
+    }
+
+    for (int j = y; j < y + h - 16; j++)
+        byte_copy(&image->data[j * image->stride + x],
+                  &image->data[(j + 16) * image->stride + x], w * 4);
+
+    desktop_text(image, x, y + h - 16, w, 16, 0x202020, 0xf8f8f8);
+    area_set(area, x, y, w, h);
+}
+
+static void
+draw_drag(image_info_t *image, int i, desktop_area_t *area)
+{
+    const int w = MIN(800, image->w / 2);
+    const int h = MIN(600, image->h / 2);
+    const int rx = image->w - w;
+    const int ry = image->h - h;
+
+    static image_info_t window;
+
+    if (!i) {
+        safe_free(window.data);
+        window.data = safe_malloc(w * h * 4);
+        window.stride = window.w = w;
+        window.h = h;
+        draw_window(&window, 0, 0, w, h);
+        draw_desktop(image, 0, 0, image->w, image->h);
+        area_set(area, 0, 0, image->w, image->h);
+    }
+
+    const int k = i ? i - 1 : 0;
+    const int ox = abs((k * 12) % (2 * rx) - rx);
+    const int oy = abs((k * 5) % (2 * ry) - ry);
+    const int nx = abs((i * 12) % (2 * rx) - rx);
+    const int ny = abs((i * 5) % (2 * ry) - ry);
+
+    if (i) {
+        draw_desktop(image, ox, oy, w, h);
+        area_set(area, ox, oy, w, h);
+        area_add(area, nx, ny, w, h);
+    }
+
+    for (int j = 0; j < h; j++)
+        byte_copy(&image->data[(ny + j) * image->stride + nx],
+                  &window.data[j * window.stride], w * 4);
+}
+
+static void
+draw_video(image_info_t *image, int i, desktop_area_t *area)
+{
+    const int w = MIN(640, image->w - 200) / 8 * 8;
+    const int h = MIN(360, image->h - 174) / 8 * 8;
+    const int x = 200, y = 150;
+
+    if (!i) {
+        draw_desktop(image, 0, 0, image->w, image->h);
+        draw_window(image, x - 16, y - 40, w + 32, h + 56);
+    }
+
+    for (int j = 0; j < h; j++) {
+        for (int k = 0; k < w; k++) {
+            const uint32_t r = ((k + 3 * i) ^ (j - 2 * i)) & 0xFF;
+            const uint32_t g = ((k * j / 64) + 4 * i) & 0xFF;
+            const uint32_t b = (((k - i) * (k - i) + (j + i) * (j + i)) >> 8) & 0xFF;
+            const uint32_t n = desktop_rand() & 0x070707;
+            image->data[(y + j) * image->stride + x + k] = (r << 16 | g << 8 | b) ^ n;
+        }
+    }
+
+    if (i)
+        area_set(area, x, y, w, h);
+    else
+        area_set(area, 0, 0, image->w, image->h);
+}
+
+static void
+draw_photo(image_info_t *image, _unused_ int i, desktop_area_t *area)
+{
+    uint32_t grid[17][17];
+
+    for (int j = 0; j < 17; j++)
+        for (int k = 0; k < 17; k++)
+            grid[j][k] = desktop_rand() & 0xFFFFFF;
+
+    const int gw = DIV(image->w, 16);
+    const int gh = DIV(image->h, 16);
+
+    for (int j = 0; j < image->h; j++) {
+        const int gj = j / gh, fj = j % gh;
+        for (int k = 0; k < image->w; k++) {
+            const int gk = k / gw, fk = k % gw;
+            uint32_t c = 0;
+            for (int s = 0; s < 24; s += 8) {
+                const int a = (grid[gj][gk] >> s) & 0xFF;
+                const int b = (grid[gj][gk + 1] >> s) & 0xFF;
+                const int d = (grid[gj + 1][gk] >> s) & 0xFF;
+                const int e = (grid[gj + 1][gk + 1] >> s) & 0xFF;
+                const int top = a + (b - a) * fk / gw;
+                const int bot = d + (e - d) * fk / gw;
+                const int v = top + (bot - top) * fj / gh + (int)(desktop_rand() & 15) - 8;
+                c |= (uint32_t)CLAMP(v, 0, 255) << s;
+            }
+            image->data[j * image->stride + k] = c;
+        }
+    }
+
+    area_set(area, 0, 0, image->w, image->h);
+}
+
+static const struct {
+    const char *name;
+    void (*draw)(image_info_t *, int, desktop_area_t *);
+} desktop[] = {
+    {"typing", draw_typing},
+    {"scroll", draw_scroll},
+    {"drag", draw_drag},
+    {"video", draw_video},
+    {"photo", draw_photo},
+};
+
+const char *
+desktop_name(unsigned k)
+{
+    return k < COUNT(desktop) ? desktop[k].name : NULL;
+}
+
+int
+desktop_find(const char *name)
+{
+    for (size_t k = 0; k < COUNT(desktop); k++) {
+        if (!str_cmp(name, desktop[k].name))
+            return k;
+    }
+
+    return -1;
+}
+
+void
+desktop_draw(unsigned k, image_info_t *image, int i, desktop_area_t *area)
+{
+    if (k < COUNT(desktop))
+        desktop[k].draw(image, i, area);
+}
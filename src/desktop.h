@@ -0,0 +1,16 @@
+#pragma once
+
+#include "common.h"
+
+typedef struct desktop_area desktop_area_t;
+
+struct desktop_area {
+    int x, y, w, h;
+};
+
+uint32_t    desktop_rand (void);
+void        desktop_rect (image_info_t *, int, int, int, int, uint32_t);
+void        desktop_text (image_info_t *, int, int, int, int, uint32_t, uint32_t);
+const char *desktop_name (unsigned);
+int         desktop_find (const char *);
+void        desktop_draw (unsigned, image_info_t *, int, desktop_area_t *);
@@ -0,0 +1,132 @@
+#include "event.h"
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define EVENT_MAX 64
+
+static struct event_global {
+    int fd;
+    int timer;
+    int expired;
+    int count;
+    struct epoll_event events[EVENT_MAX];
+} global = {
+    .fd = -1,
+    .timer = -1,
+};
+
+void
+event_init(void)
+{
+    global.fd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (global.fd == -1)
+        error("couldn't create epoll: %m\n");
+
+    global.timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (global.timer == -1)
+        error("couldn't create timerfd: %m\n");
+
+    event_set(global.timer, SOCKET_WAIT_R);
+}
+
+void
+event_exit(void)
+{
+    if (global.timer != -1)
+        close(global.timer);
+
+    if (global.fd != -1)
+        close(global.fd);
+
+    global.timer = -1;
+    global.fd = -1;
+}
+
+int
+event_set(int fd, int events)
+{
+    if (fd == -1)
+        return -1;
+
+    if (!events) {
+        for (int k = 0; k < global.count; k++) {
+            if (global.events[k].data.fd == fd)
+                global.events[k].events = 0;
+        }
+        return epoll_ctl(global.fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+
+    struct epoll_event ev = {
+        .events = ((events & SOCKET_WAIT_R) ? EPOLLIN : 0)
+                | ((events & SOCKET_WAIT_W) ? EPOLLOUT : 0),
+        .data.fd = fd,
+    };
+
+    int ret = epoll_ctl(global.fd, EPOLL_CTL_MOD, fd, &ev);
+
+    if (ret == -1 && errno == ENOENT)
+        ret = epoll_ctl(global.fd, EPOLL_CTL_ADD, fd, &ev);
+
+    if (ret == -1)
+        warning("epoll_ctl: %m\n");
+
+    return ret;
+}
+
+void
+event_timer(int ms)
+{
+    struct itimerspec its = {0};
+
+    if (ms > 0) {
+        its.it_value.tv_sec = ms / 1000;
+        its.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    } else if (!ms) {
+        its.it_value.tv_nsec = 1;
+    }
+
+    timerfd_settime(global.timer, 0, &its, NULL);
+}
+
+int
+event_wait(int ms)
+{
+    int ret = epoll_wait(global.fd, global.events, EVENT_MAX, ms);
+
+    global.count = ret > 0 ? ret : 0;
+    global.expired = !!event_get(global.timer);
+
+    if (global.expired) {
+        uint64_t expired;
+        if (read(global.timer, &expired, sizeof(expired)) == -1 && errno != EAGAIN)
+            warning("timerfd: %m\n");
+    }
+
+    return ret;
+}
+
+int
+event_expired(void)
+{
+    return global.expired;
+}
+
+int
+event_get(int fd)
+{
+    int events = 0;
+
+    for (int k = 0; k < global.count; k++) {
+        if (global.events[k].data.fd != fd)
+            continue;
+        if (global.events[k].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            events |= SOCKET_WAIT_R;
+        if (global.events[k].events & EPOLLOUT)
+            events |= SOCKET_WAIT_W;
+    }
+
+    return events;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "socket.h"
+
+void event_init    (void);
+void event_exit    (void);
+int  event_set     (int, int);
+void event_timer   (int);
+int  event_wait    (int);
+int  event_get     (int);
+int  event_expired (void);
@@ -111,6 +111,23 @@ image_get(image_t *image, int draw_x, int draw_y)
     }
 }
 
+void
+image_get_area(image_t *image, int x, int y, int w, int h)
+{
+    if (!image)
+        return;
+
+    if (image->shm.shmid != -1) {
+        XImage id = *image->id;
+        id.height = h;
+        id.data += y * id.bytes_per_line;
+        XShmGetImage(display.id, image->drawable, &id, 0, y, AllPlanes);
+    } else {
+        XGetSubImage(display.id, image->drawable, x, y, w, h, AllPlanes,
+                     ZPixmap, image->id, x, y);
+    }
+}
+
 void
 image_put(image_t *image, int x, int y,
           int draw_x, int draw_y, int draw_w, int draw_h)
@@ -14,7 +14,8 @@ struct image {
     GC gc;
 };
 
-void image_create (image_t *, Drawable, int, int);
-void image_delete (image_t *);
-void image_get    (image_t *, int, int);
-void image_put    (image_t *, int, int, int, int, int, int);
+void image_create   (image_t *, Drawable, int, int);
+void image_delete   (image_t *);
+void image_get      (image_t *, int, int);
+void image_get_area (image_t *, int, int, int, int);
+void image_put      (image_t *, int, int, int, int, int, int);
@@ -166,6 +166,9 @@ input_key(uint8_t key, KeySym keysym, int press)
 {
     int keycode = 0;
 
+    if (!display.id)
+        return;
+
     if (press) {
         if (!keysym ||
             keysym == XK_Caps_Lock ||
@@ -199,7 +202,7 @@ input_key(uint8_t key, KeySym keysym, int press)
 void
 input_button(uint8_t button, int press)
 {
-    if (button > 31)
+    if (!display.id || button > 31)
         return;
 
     if (press) {
@@ -215,6 +218,9 @@ input_button(uint8_t button, int press)
 void
 input_pointer(int x, int y, int rel)
 {
+    if (!display.id)
+        return;
+
     Window w = rel ? None : display.root;
     XWarpPointer(display.id, None, w, 0, 0, 0, 0, x, y);
     XFlush(display.id);
@@ -195,8 +195,17 @@ netio_start(netio_t *netio)
         return 0;
     }
 
+    const int ktls = openssl_get_ktls(netio->ssl);
+
+    if (ktls & 1)
+        netio->state |= NETIO_KTLS_SEND;
+
+    if (ktls & 2)
+        netio->state |= NETIO_KTLS_RECV;
+
     netio->proto = STR_MAKE(SSL_get_version(netio->ssl), " (",
-                            SSL_CIPHER_get_name(SSL_get_current_cipher(netio->ssl)), ")");
+                            SSL_CIPHER_get_name(SSL_get_current_cipher(netio->ssl)),
+                            ktls ? ", kTLS" : "", ")");
 #else
 
 #ifndef __EMSCRIPTEN__
@@ -317,6 +326,30 @@ netio_read(netio_t *netio)
     return 1;
 }
 
+#ifndef __EMSCRIPTEN__
+static int
+netio_write_fd(netio_t *netio, buffer_t *buffer, size_t size)
+{
+#ifdef _WIN32
+    return write(netio->fd, buffer->read, size); // TODO win
+#else
+    struct iovec iov[2] = {
+        {.iov_base = buffer->read, .iov_len = size},
+    };
+
+    int count = 1;
+
+    if (buffer != netio->tail && netio->tail) {
+        iov[1].iov_base = netio->tail->read;
+        iov[1].iov_len = buffer_read_size(netio->tail);
+        count = 2;
+    }
+
+    return writev(netio->fd, iov, count);
+#endif
+}
+#endif
+
 int
 netio_write(netio_t *netio)
 {
@@ -328,6 +361,9 @@ netio_write(netio_t *netio)
 
     buffer_t *buffer = &netio->output;
 
+    if (!buffer_read_size(buffer) && netio->tail)
+        buffer = netio->tail;
+
     size_t size = buffer_read_size(buffer);
 
     if (!size)
@@ -344,40 +380,63 @@ netio_write(netio_t *netio)
         return -1;
 #else
 #ifndef NETIO_NO_SSL
-    netio->state &= ~NETIO_WRITE_WANT_READ;
-
-    ret = SSL_write(netio->ssl, buffer->read, size);
+    if (!(netio->state & NETIO_KTLS_SEND)) {
+        netio->state &= ~NETIO_WRITE_WANT_READ;
+
+        ret = SSL_write(netio->ssl, buffer->read, size);
+
+        if (ret <= 0) {
+            switch (SSL_get_error(netio->ssl, ret)) {
+            case SSL_ERROR_WANT_READ:
+                netio->state |= NETIO_WRITE_WANT_READ;
+                /* FALLTHRU */
+            case SSL_ERROR_WANT_WRITE:
+                return -1;
+            case SSL_ERROR_SYSCALL:
+                if (ret == -1 && errno)
+                    warning("%s: %m\n", netio->name);
+            }
+            openssl_print_error(netio->name);
+            return 0;
+        }
+    } else
+#endif
+    {
+        ret = netio_write_fd(netio, buffer, size);
 
-    if (ret <= 0) {
-        switch (SSL_get_error(netio->ssl, ret)) {
-        case SSL_ERROR_WANT_READ:
-            netio->state |= NETIO_WRITE_WANT_READ;
-            /* FALLTHRU */
-        case SSL_ERROR_WANT_WRITE:
-            return -1;
-        case SSL_ERROR_SYSCALL:
-            if (ret == -1 && errno)
+        if (ret == -1) {
+            if (errno == EAGAIN || errno == EINTR)
+                return -1;
+            if (errno)
                 warning("%s: %m\n", netio->name);
+            return 0;
         }
-        openssl_print_error(netio->name);
-        return 0;
     }
-#else
-    ret = write(netio->fd, buffer->read, size); // TODO win
+#endif
 
-    if (ret == -1) {
-        if (errno == EAGAIN || errno == EINTR)
-            return -1;
-        if (errno)
-            warning("%s: %m\n", netio->name);
+    buffer->read += MIN((size_t)ret, size);
+
+    if (buffer == &netio->output)
+        buffer_shift(buffer);
+
+    if ((size_t)ret > size)
+        netio->tail->read += ret - size;
+
+    if (netio->tail && !buffer_read_size(netio->tail))
+        netio->tail = NULL;
+
+    return 1;
+}
+
+int
+netio_send(netio_t *netio, buffer_t *buffer)
+{
+    if (!buffer || !buffer_read_size(buffer)) {
+        netio->tail = NULL;
         return 0;
     }
-#endif
-#endif
-
-    buffer->read += ret;
 
-    buffer_shift(buffer);
+    netio->tail = buffer;
 
     return 1;
 }
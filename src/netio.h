@@ -11,6 +11,8 @@
 #define NETIO_ACCEPT           (1<<2)
 #define NETIO_READ_WANT_WRITE  (1<<3)
 #define NETIO_WRITE_WANT_READ  (1<<4)
+#define NETIO_KTLS_SEND        (1<<5)
+#define NETIO_KTLS_RECV        (1<<6)
 
 typedef struct netio netio_t;
 
@@ -24,6 +26,7 @@ struct netio {
 #endif
     buffer_t input;
     buffer_t output;
+    buffer_t *tail;
 };
 
 int  netio_create (netio_t *, const char *, const char *, int);
@@ -33,3 +36,4 @@ int  netio_start  (netio_t *);
 int  netio_stop   (netio_t *);
 int  netio_read   (netio_t *);
 int  netio_write  (netio_t *);
+int  netio_send   (netio_t *, buffer_t *);
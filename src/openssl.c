@@ -548,6 +548,35 @@ openssl_use_ciphers(const char *ciphers)
         error("couldn't set ciphers\n");
 }
 
+void
+openssl_use_ktls(int use)
+{
+    if (!global.ctx || !use)
+        return;
+
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(global.ctx, SSL_OP_ENABLE_KTLS);
+#else
+    warning("kernel TLS is not supported by this OpenSSL\n");
+#endif
+}
+
+int
+openssl_get_ktls(_unused_ SSL *ssl)
+{
+    int ret = 0;
+
+#ifdef SSL_OP_ENABLE_KTLS
+    if (BIO_get_ktls_send(SSL_get_wbio(ssl)))
+        ret |= 1;
+
+    if (BIO_get_ktls_recv(SSL_get_rbio(ssl)))
+        ret |= 2;
+#endif
+
+    return ret;
+}
+
 void
 openssl_use_ecdh(const char *name)
 {
@@ -21,3 +21,5 @@ void   openssl_delete_cert   (char *);
 SSL   *openssl_create        (int, int);
 void   openssl_delete        (SSL *);
 int    openssl_verify        (SSL *, int);
+void   openssl_use_ktls      (int);
+int    openssl_get_ktls      (SSL *);
@@ -0,0 +1,78 @@
+#include "perf.h"
+
+uint64_t
+perf_time(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts))
+        return 0;
+
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static unsigned
+perf_index(uint64_t v)
+{
+    if (v < 8)
+        return v;
+
+    if (v > UINT32_MAX)
+        return PERF_BUCKETS - 1;
+
+    const unsigned o = 31 - CLZ((uint32_t)v);
+
+    return MIN(8 + 4 * (o - 3) + ((v >> (o - 2)) & 3), PERF_BUCKETS - 1);
+}
+
+static uint64_t
+perf_value(unsigned k)
+{
+    if (k < 8)
+        return k;
+
+    const unsigned o = (k - 8) / 4 + 3;
+
+    return ((5ULL + (k - 8) % 4) << (o - 2)) - 1;
+}
+
+void
+perf_add(perf_t *perf, uint64_t v)
+{
+    if (!perf)
+        return;
+
+    perf->bucket[perf_index(v)]++;
+    perf->count++;
+
+    if (perf->max < v)
+        perf->max = v;
+}
+
+uint64_t
+perf_get(const perf_t *perf, unsigned percent)
+{
+    if (!perf || !perf->count)
+        return 0;
+
+    const uint64_t rank = DIV(perf->count * MIN(percent, 100), 100);
+    uint64_t sum = 0;
+
+    for (unsigned k = 0; k < PERF_BUCKETS; k++) {
+        sum += perf->bucket[k];
+        if (sum >= rank && sum)
+            return MIN(perf_value(k), perf->max);
+    }
+
+    return perf->max;
+}
+
+char *
+perf_str(const char *name, const perf_t *perf)
+{
+    return STR_MAKE(name,
+                    ": count=", STR_ULL(perf->count),
+                    " p50=", STR_ULL(perf_get(perf, 50)),
+                    " p99=", STR_ULL(perf_get(perf, 99)),
+                    " max=", STR_ULL(perf->max), "\n");
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "common.h"
+
+#define PERF_BUCKETS 128
+
+typedef struct perf perf_t;
+
+struct perf {
+    uint64_t count;
+    uint64_t max;
+    uint32_t bucket[PERF_BUCKETS];
+};
+
+uint64_t perf_time  (void);
+void     perf_add   (perf_t *, uint64_t);
+uint64_t perf_get   (const perf_t *, unsigned);
+char    *perf_str   (const char *, const perf_t *);
@@ -0,0 +1,100 @@
+src/release-x86_64-acl.o: src/acl.c src/acl.h src/common.h src/config.h src/common-static.h
+src/release-x86_64-auth-gss-server.o: src/auth-gss-server.c src/auth-gss-server.h \
+ src/auth-gss.h src/common.h src/config.h src/user.h src/common-static.h
+src/release-x86_64-auth-gss.o: src/auth-gss.c src/auth-gss.h src/common.h src/config.h \
+ src/buffer-static.h src/common-static.h
+src/release-x86_64-auth-pam.o: src/auth-pam.c src/auth-pam.h src/common.h src/config.h \
+ src/user.h src/buffer-static.h src/common-static.h
+src/release-x86_64-auth-ssl.o: src/auth-ssl.c src/auth-ssl.h src/openssl.h src/common.h \
+ src/config.h src/base64.h src/storage.h
+src/release-x86_64-base64.o: src/base64.c src/base64.h src/common.h src/config.h \
+ src/buffer-static.h src/common-static.h
+src/release-x86_64-client-js.o: src/client-js.c src/common-static.h src/common.h \
+ src/config.h src/core-client.h src/netio.h src/socket.h src/openssl.h \
+ src/base64.h src/token.h src/tycho-client.h src/tycho.h src/command.h \
+ src/utf8-static.h src/utf8.h src/keysym.h src/keysymdef.h
+src/release-x86_64-client-win.o: src/client-win.c src/buffer-static.h src/common-static.h \
+ src/common.h src/config.h src/core-client.h src/netio.h src/socket.h \
+ src/openssl.h src/base64.h src/token.h src/tycho-client.h src/tycho.h \
+ src/command.h src/option.h
+src/release-x86_64-client.o: src/client.c src/buffer-static.h src/common-static.h \
+ src/common.h src/config.h src/core-client.h src/netio.h src/socket.h \
+ src/openssl.h src/base64.h src/token.h src/tycho-client.h src/tycho.h \
+ src/command.h src/option.h src/clipboard.h src/display.h src/image.h \
+ src/pointer.h src/terminal.h src/worker.h src/auth-gss.h src/auth-ssl.h \
+ src/storage.h
+src/release-x86_64-clipboard.o: src/clipboard.c src/clipboard.h src/display.h src/common.h \
+ src/config.h src/common-static.h
+src/release-x86_64-common.o: src/common.c src/common-static.h src/common.h src/config.h
+src/release-x86_64-core-client.o: src/core-client.c src/core-client.h src/common.h \
+ src/config.h src/netio.h src/socket.h src/openssl.h src/base64.h \
+ src/token.h src/tycho-client.h src/tycho.h src/command.h \
+ src/buffer-static.h src/common-static.h
+src/release-x86_64-display.o: src/display.c src/display.h src/common.h src/config.h \
+ src/color-static.h src/common-static.h
+src/release-x86_64-event.o: src/event.c src/event.h src/socket.h src/common.h src/config.h
+src/release-x86_64-image.o: src/image.c src/image.h src/display.h src/common.h src/config.h \
+ src/common-static.h
+src/release-x86_64-input.o: src/input.c src/input.h src/display.h src/common.h src/config.h \
+ src/common-static.h
+src/release-x86_64-netio.o: src/netio.c src/netio.h src/socket.h src/common.h src/config.h \
+ src/openssl.h src/base64.h src/buffer-static.h src/common-static.h
+src/release-x86_64-openssl.o: src/openssl.c src/openssl.h src/common.h src/config.h \
+ src/base64.h src/buffer-static.h src/common-static.h
+src/release-x86_64-option.o: src/option.c src/option.h src/common.h src/config.h
+src/release-x86_64-perf.o: src/perf.c src/perf.h src/common.h src/config.h
+src/release-x86_64-pointer.o: src/pointer.c src/pointer.h src/display.h src/common.h \
+ src/config.h src/common-static.h
+src/release-x86_64-screen.o: src/screen.c src/screen.h src/common.h src/config.h \
+ src/common-static.h src/perf.h src/tycho.h src/worker.h
+src/release-x86_64-server.o: src/server.c src/buffer-static.h src/common-static.h \
+ src/common.h src/config.h src/event.h src/socket.h src/netio.h \
+ src/openssl.h src/base64.h src/option.h src/perf.h src/screen.h \
+ src/source.h src/token.h src/tycho-server.h src/tycho.h src/command.h \
+ src/clipboard.h src/display.h src/image.h src/input.h src/xdamage.h \
+ src/xrandr.h src/acl.h src/ucs_to_keysym.h src/user.h src/worker.h \
+ src/auth-gss-server.h src/auth-gss.h src/auth-pam.h src/auth-ssl.h \
+ src/storage.h
+src/release-x86_64-socket.o: src/socket.c src/socket.h src/common.h src/config.h
+src/release-x86_64-source.o: src/source.c src/source.h src/common.h src/config.h \
+ src/common-static.h src/tga.h
+src/release-x86_64-storage.o: src/storage.c src/storage.h src/common.h src/config.h \
+ src/buffer-static.h src/common-static.h
+src/release-x86_64-terminal.o: src/terminal.c src/terminal.h src/common.h src/config.h \
+ src/common-static.h src/utf8-static.h
+src/release-x86_64-test-base64.o: src/test-base64.c src/base64.h src/common.h src/config.h \
+ src/buffer-static.h src/common-static.h src/option.h
+src/release-x86_64-test-byte.o: src/test-byte.c src/common-static.h src/common.h \
+ src/config.h src/option.h
+src/release-x86_64-test-grab.o: src/test-grab.c src/option.h src/common.h src/config.h \
+ src/display.h src/image.h src/tga.h
+src/release-x86_64-test-kbd-show.o: src/test-kbd-show.c src/common.h src/config.h \
+ src/display.h src/option.h
+src/release-x86_64-test-load.o: src/test-load.c src/core-client.h src/common.h src/config.h \
+ src/netio.h src/socket.h src/openssl.h src/base64.h src/token.h \
+ src/tycho-client.h src/tycho.h src/command.h src/event.h src/option.h \
+ src/perf.h src/worker.h src/auth-ssl.h src/storage.h
+src/release-x86_64-test-tycho.o: src/test-tycho.c src/buffer-static.h src/common-static.h \
+ src/common.h src/config.h src/option.h src/perf.h src/tga.h \
+ src/tycho-client.h src/tycho.h src/tycho-server.h src/worker.h
+src/release-x86_64-tga.o: src/tga.c src/tga.h src/common.h src/config.h
+src/release-x86_64-token.o: src/token.c src/token.h src/common.h src/config.h \
+ src/buffer-static.h src/common-static.h
+src/release-x86_64-tycho-client.o: src/tycho-client.c src/tycho-client.h src/tycho.h \
+ src/common.h src/config.h src/color-static.h src/tycho-static.h \
+ src/buffer-static.h src/common-static.h src/worker.h
+src/release-x86_64-tycho-server.o: src/tycho-server.c src/tycho-server.h src/tycho.h \
+ src/common.h src/config.h src/tycho-static.h src/buffer-static.h \
+ src/common-static.h src/color-static.h src/worker.h
+src/release-x86_64-tycho.o: src/tycho.c src/tycho.h src/common.h src/config.h \
+ src/common-static.h src/tycho-static.h src/buffer-static.h
+src/release-x86_64-ucs_to_keysym.o: src/ucs_to_keysym.c src/ucs_to_keysym.h \
+ src/ucs_to_keysym-static.h
+src/release-x86_64-user.o: src/user.c src/user.h src/common.h src/config.h \
+ src/common-static.h
+src/release-x86_64-utf8.o: src/utf8.c src/utf8.h src/common.h src/config.h src/utf8-static.h
+src/release-x86_64-worker.o: src/worker.c src/worker.h src/common.h src/config.h
+src/release-x86_64-xdamage.o: src/xdamage.c src/xdamage.h src/display.h src/common.h \
+ src/config.h
+src/release-x86_64-xrandr.o: src/xrandr.c src/xrandr.h src/display.h src/common.h \
+ src/config.h
@@ -0,0 +1,549 @@
+#include "screen.h"
+#include "common-static.h"
+#include "perf.h"
+#include "tycho.h"
+#include "worker.h"
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <xcb/xcb.h>
+#include <xcb/damage.h>
+#include <xcb/shm.h>
+#include <xcb/xfixes.h>
+
+typedef struct screen_buffer screen_buffer_t;
+typedef struct screen_job screen_job_t;
+
+struct screen_buffer {
+    xcb_shm_seg_t seg;
+    image_info_t image;
+    uint8_t *dirty;
+};
+
+struct screen_job {
+    int active;
+    int buffer;
+    int fetch;
+    int fail;
+    int x, y;
+    const image_info_t *src;
+    screen_area_t *grab;
+    screen_area_t *copy;
+    int grab_count;
+    int copy_count;
+    xcb_shm_get_image_cookie_t *cookie;
+    xcb_xfixes_get_cursor_image_reply_t *cursor;
+    uint64_t time;
+};
+
+static struct screen_global {
+    xcb_connection_t *c;
+    xcb_window_t root;
+    int w, h;
+    uint8_t damage_event;
+    uint8_t xfixes_event;
+    xcb_damage_damage_t damage;
+    screen_buffer_t buffer[CONFIG_SCREEN_BUFFERS];
+    int held;
+    int full;
+    int *x0, *x1;
+    screen_area_t *area;
+    int count;
+    screen_job_t job;
+    struct {
+        screen_cursor_t image;
+        xcb_xfixes_get_cursor_image_reply_t *reply;
+        int pending;
+    } cursor;
+} global;
+
+static const xcb_query_extension_reply_t *
+screen_extension(xcb_extension_t *ext, const char *name)
+{
+    const xcb_query_extension_reply_t *reply = xcb_get_extension_data(global.c, ext);
+
+    if (!reply || !reply->present) {
+        warning("couldn't query %s extension\n", name);
+        return NULL;
+    }
+
+    return reply;
+}
+
+int
+screen_init(void)
+{
+    int num = 0;
+
+    global.c = xcb_connect(NULL, &num);
+
+    if (xcb_connection_has_error(global.c)) {
+        warning("couldn't connect to the X server\n");
+        goto fail;
+    }
+
+    xcb_screen_iterator_t it = xcb_setup_roots_iterator(xcb_get_setup(global.c));
+
+    for (; num > 0 && it.rem; num--)
+        xcb_screen_next(&it);
+
+    if (!it.rem || it.data->root_depth < 24) {
+        warning("default depth is not supported\n");
+        goto fail;
+    }
+
+    global.root = it.data->root;
+    global.w = it.data->width_in_pixels;
+    global.h = it.data->height_in_pixels;
+
+    xcb_prefetch_extension_data(global.c, &xcb_shm_id);
+    xcb_prefetch_extension_data(global.c, &xcb_damage_id);
+    xcb_prefetch_extension_data(global.c, &xcb_xfixes_id);
+
+    const xcb_query_extension_reply_t *shm = screen_extension(&xcb_shm_id, "MIT-SHM");
+    const xcb_query_extension_reply_t *damage = screen_extension(&xcb_damage_id, "DAMAGE");
+    const xcb_query_extension_reply_t *xfixes = screen_extension(&xcb_xfixes_id, "XFIXES");
+
+    if (!shm || !damage || !xfixes)
+        goto fail;
+
+    global.damage_event = damage->first_event;
+    global.xfixes_event = xfixes->first_event;
+
+    xcb_shm_query_version_cookie_t shm_version =
+        xcb_shm_query_version(global.c);
+    xcb_damage_query_version_cookie_t damage_version =
+        xcb_damage_query_version(global.c, XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION);
+    xcb_xfixes_query_version_cookie_t xfixes_version =
+        xcb_xfixes_query_version(global.c, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION);
+
+    safe_free(xcb_shm_query_version_reply(global.c, shm_version, NULL));
+    safe_free(xcb_damage_query_version_reply(global.c, damage_version, NULL));
+    safe_free(xcb_xfixes_query_version_reply(global.c, xfixes_version, NULL));
+
+    global.damage = xcb_generate_id(global.c);
+    xcb_damage_create(global.c, global.damage, global.root,
+                      XCB_DAMAGE_REPORT_LEVEL_DELTA_RECTANGLES);
+
+    xcb_xfixes_select_cursor_input(global.c, global.root,
+                                   XCB_XFIXES_CURSOR_NOTIFY_MASK_DISPLAY_CURSOR);
+
+    const uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    xcb_change_window_attributes(global.c, global.root, XCB_CW_EVENT_MASK, &mask);
+
+    xcb_flush(global.c);
+
+    global.cursor.pending = 1;
+    global.held = -1;
+    global.full = 1;
+
+    return xcb_get_file_descriptor(global.c);
+
+fail:
+    screen_exit();
+    return -1;
+}
+
+static void
+screen_shm_delete(screen_buffer_t *buffer)
+{
+    if (buffer->image.data) {
+        xcb_shm_detach(global.c, buffer->seg);
+        shmdt(buffer->image.data);
+    }
+
+    safe_free(buffer->dirty);
+
+    byte_set(buffer, 0, sizeof(screen_buffer_t));
+}
+
+static int
+screen_shm_create(screen_buffer_t *buffer, int w, int h)
+{
+    int id = shmget(IPC_PRIVATE, (size_t)w * h * 4, IPC_CREAT | 0600);
+
+    if (id == -1) {
+        warning("%s: %m\n", "shmget");
+        return 1;
+    }
+
+    void *data = shmat(id, NULL, 0);
+
+    if (data == (void *)-1) {
+        warning("%s: %m\n", "shmat");
+        shmctl(id, IPC_RMID, NULL);
+        return 1;
+    }
+
+    buffer->seg = xcb_generate_id(global.c);
+
+    xcb_generic_error_t *err = xcb_request_check(global.c,
+            xcb_shm_attach_checked(global.c, buffer->seg, id, 0));
+
+    shmctl(id, IPC_RMID, NULL);
+
+    if (err) {
+        warning("couldn't create XShm image\n");
+        safe_free(err);
+        shmdt(data);
+        return 1;
+    }
+
+    buffer->image.data = data;
+    buffer->image.stride = w;
+    buffer->image.w = w;
+    buffer->image.h = h;
+    buffer->dirty = safe_calloc(DIV(h, TILE_SIZE), 1);
+
+    return 0;
+}
+
+static void
+screen_delete(void)
+{
+    for (int k = 0; k < CONFIG_SCREEN_BUFFERS; k++)
+        screen_shm_delete(&global.buffer[k]);
+
+    safe_free(global.x0);
+    safe_free(global.x1);
+    safe_free(global.area);
+    safe_free(global.job.grab);
+    safe_free(global.job.copy);
+    safe_free(global.job.cookie);
+
+    global.x0 = NULL;
+    global.x1 = NULL;
+    global.area = NULL;
+    global.job.grab = NULL;
+    global.job.copy = NULL;
+    global.job.cookie = NULL;
+    global.held = -1;
+}
+
+static int
+screen_resize(void)
+{
+    screen_delete();
+
+    const int w = global.w;
+    const int h = global.h;
+    const int hn = DIV(h, TILE_SIZE);
+
+    for (int k = 0; k < CONFIG_SCREEN_BUFFERS; k++) {
+        if (screen_shm_create(&global.buffer[k], w, h)) {
+            screen_delete();
+            return 1;
+        }
+    }
+
+    global.x0 = safe_calloc(hn, sizeof(int));
+    global.x1 = safe_calloc(hn, sizeof(int));
+    global.area = safe_calloc(hn, sizeof(screen_area_t));
+    global.job.grab = safe_calloc(hn, sizeof(screen_area_t));
+    global.job.copy = safe_calloc(hn, sizeof(screen_area_t));
+    global.job.cookie = safe_calloc(hn, sizeof(xcb_shm_get_image_cookie_t));
+
+    for (int j = 0; j < hn; j++)
+        global.x0[j] = w;
+
+    global.full = 1;
+
+    return 0;
+}
+
+void
+screen_exit(void)
+{
+    if (!global.c)
+        return;
+
+    if (global.job.active)
+        worker_wait();
+
+    screen_delete();
+
+    safe_free(global.job.cursor);
+    safe_free(global.cursor.reply);
+
+    xcb_disconnect(global.c);
+
+    byte_set(&global, 0, sizeof(global));
+}
+
+static void
+screen_mark(int x, int y, int w, int h)
+{
+    const image_info_t *const image = &global.buffer[0].image;
+
+    if (!image->data)
+        return;
+
+    const int x0 = MAX(x, 0);
+    const int x1 = MIN(x + w, image->w);
+    const int j0 = MAX(y, 0) / TILE_SIZE;
+    const int j1 = MIN(DIV(y + h, TILE_SIZE), DIV(image->h, TILE_SIZE));
+
+    if (x0 >= x1)
+        return;
+
+    for (int j = j0; j < j1; j++) {
+        global.x0[j] = MIN(global.x0[j], x0);
+        global.x1[j] = MAX(global.x1[j], x1);
+
+        for (int k = 0; k < CONFIG_SCREEN_BUFFERS; k++)
+            global.buffer[k].dirty[j] = 1;
+    }
+}
+
+void
+screen_event(void)
+{
+    if (!global.c)
+        return;
+
+    xcb_generic_event_t *event;
+
+    while (event = xcb_poll_for_event(global.c), event) {
+        const uint8_t type = event->response_type & 0x7F;
+
+        if (type == global.damage_event + XCB_DAMAGE_NOTIFY) {
+            const xcb_damage_notify_event_t *ev = (void *)event;
+            screen_mark(ev->area.x, ev->area.y, ev->area.width, ev->area.height);
+        } else if (type == global.xfixes_event + XCB_XFIXES_CURSOR_NOTIFY) {
+            global.cursor.pending = 1;
+        } else if (type == XCB_CONFIGURE_NOTIFY) {
+            const xcb_configure_notify_event_t *ev = (void *)event;
+            if (ev->window == global.root) {
+                global.w = ev->width;
+                global.h = ev->height;
+            }
+        }
+
+        safe_free(event);
+    }
+
+    if (xcb_connection_has_error(global.c))
+        error("lost connection to the X server\n");
+}
+
+static int
+screen_spans(screen_area_t *area, const uint8_t *rows, uint8_t mode, int w, int h)
+{
+    const int hn = DIV(h, TILE_SIZE);
+    int count = 0;
+
+    for (int j = 0; j < hn;) {
+        if (rows[j] != mode) {
+            j++;
+            continue;
+        }
+
+        int n = j;
+
+        while (n < hn && rows[n] == mode)
+            n++;
+
+        const int y = j * TILE_SIZE;
+
+        area[count++] = (screen_area_t){0, y, w, MIN(n * TILE_SIZE, h) - y};
+
+        j = n;
+    }
+
+    return count;
+}
+
+static void
+screen_capture(void *data, _unused_ unsigned k)
+{
+    screen_job_t *const job = data;
+    screen_buffer_t *const buffer = &global.buffer[job->buffer];
+    image_info_t *const image = &buffer->image;
+
+    const uint64_t start = perf_time();
+
+    for (int i = 0; i < job->grab_count; i++) {
+        const screen_area_t *const area = &job->grab[i];
+        job->cookie[i] = xcb_shm_get_image(global.c, global.root,
+                                           area->x, area->y, area->w, area->h,
+                                           ~0, XCB_IMAGE_FORMAT_Z_PIXMAP, buffer->seg,
+                                           (uint32_t)area->y * image->stride * 4);
+    }
+
+    xcb_query_pointer_cookie_t pointer = xcb_query_pointer(global.c, global.root);
+    xcb_xfixes_get_cursor_image_cookie_t cursor = {0};
+
+    if (job->fetch)
+        cursor = xcb_xfixes_get_cursor_image(global.c);
+
+    xcb_flush(global.c);
+
+    for (int i = 0; i < job->copy_count; i++) {
+        const screen_area_t *const area = &job->copy[i];
+        byte_copy(&image->data[area->y * image->stride],
+                  &job->src->data[area->y * job->src->stride],
+                  (size_t)area->h * image->stride * 4);
+    }
+
+    for (int i = 0; i < job->grab_count; i++) {
+        xcb_generic_error_t *err = NULL;
+        xcb_shm_get_image_reply_t *reply =
+            xcb_shm_get_image_reply(global.c, job->cookie[i], &err);
+        if (!reply || err)
+            job->fail = 1;
+        safe_free(reply);
+        safe_free(err);
+    }
+
+    xcb_query_pointer_reply_t *reply = xcb_query_pointer_reply(global.c, pointer, NULL);
+
+    if (reply) {
+        job->x = reply->root_x;
+        job->y = reply->root_y;
+        safe_free(reply);
+    }
+
+    if (job->fetch)
+        job->cursor = xcb_xfixes_get_cursor_image_reply(global.c, cursor, NULL);
+
+    job->time = perf_time() - start;
+}
+
+void
+screen_start(int keep)
+{
+    screen_job_t *const job = &global.job;
+
+    if (!global.c || job->active)
+        return;
+
+    screen_event();
+
+    const image_info_t *const image = &global.buffer[0].image;
+    const int resize = image->w != global.w || image->h != global.h;
+
+    // the held buffer is still being read, wait for the next frame
+    if (keep && (resize || global.full))
+        return;
+
+    if (resize && screen_resize())
+        return;
+
+    const int w = image->w;
+    const int h = image->h;
+    const int hn = DIV(h, TILE_SIZE);
+
+    if (global.full) {
+        global.full = 0;
+        global.held = -1;
+        screen_mark(0, 0, w, h);
+    }
+
+    const int b = (global.held + 1) % CONFIG_SCREEN_BUFFERS;
+    uint8_t *const dirty = global.buffer[b].dirty;
+
+    global.count = 0;
+
+    for (int j = 0; j < hn;) {
+        if (global.x0[j] >= global.x1[j]) {
+            j++;
+            continue;
+        }
+
+        int n = j, x0 = w, x1 = 0;
+
+        for (; n < hn && global.x0[n] < global.x1[n]; n++) {
+            x0 = MIN(x0, global.x0[n]);
+            x1 = MAX(x1, global.x1[n]);
+            global.x0[n] = w;
+            global.x1[n] = 0;
+            dirty[n] = 2;
+        }
+
+        const int y = j * TILE_SIZE;
+
+        global.area[global.count++] = (screen_area_t){x0, y, x1 - x0, MIN(n * TILE_SIZE, h) - y};
+
+        j = n;
+    }
+
+    if (global.held == -1) {
+        for (int j = 0; j < hn; j++)
+            dirty[j] = dirty[j] ? 2 : 0;
+    }
+
+    job->grab_count = screen_spans(job->grab, dirty, 2, w, h);
+    job->copy_count = screen_spans(job->copy, dirty, 1, w, h);
+
+    byte_set(dirty, 0, hn);
+
+    if (global.count)
+        xcb_damage_subtract(global.c, global.damage, XCB_NONE, XCB_NONE);
+
+    job->active = 1;
+    job->buffer = b;
+    job->src = global.held == -1 ? NULL : &global.buffer[global.held].image;
+    job->fetch = global.cursor.pending;
+    job->fail = 0;
+    job->x = global.cursor.image.x;
+    job->y = global.cursor.image.y;
+    job->cursor = NULL;
+
+    global.cursor.pending = 0;
+
+    worker_start(screen_capture, job, 1);
+}
+
+image_info_t *
+screen_get(screen_frame_t *frame)
+{
+    screen_job_t *const job = &global.job;
+
+    frame->area = global.area;
+    frame->count = 0;
+    frame->time = 0;
+
+    if (!job->active)
+        return NULL;
+
+    worker_wait();
+
+    job->active = 0;
+
+    global.cursor.image.x = job->x;
+    global.cursor.image.y = job->y;
+
+    if (job->cursor) {
+        xcb_xfixes_get_cursor_image_reply_t *const reply = job->cursor;
+        safe_free(global.cursor.reply);
+        global.cursor.reply = reply;
+        global.cursor.image.w = reply->width;
+        global.cursor.image.h = reply->height;
+        global.cursor.image.xhot = reply->xhot;
+        global.cursor.image.yhot = reply->yhot;
+        global.cursor.image.serial = reply->cursor_serial;
+        global.cursor.image.pixels = xcb_xfixes_get_cursor_image_cursor_image(reply);
+        job->cursor = NULL;
+    } else if (job->fetch) {
+        global.cursor.pending = 1;
+    }
+
+    if (job->fail) {
+        global.full = 1;
+        return NULL;
+    }
+
+    global.held = job->buffer;
+
+    frame->count = global.count;
+    frame->time = job->time;
+
+    return &global.buffer[global.held].image;
+}
+
+const screen_cursor_t *
+screen_cursor(void)
+{
+    return &global.cursor.image;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common.h"
+
+typedef struct screen_area screen_area_t;
+typedef struct screen_cursor screen_cursor_t;
+typedef struct screen_frame screen_frame_t;
+
+struct screen_area {
+    int x, y, w, h;
+};
+
+struct screen_frame {
+    const screen_area_t *area;
+    int count;
+    uint64_t time;
+};
+
+struct screen_cursor {
+    int x, y;
+    int w, h;
+    int xhot, yhot;
+    uint32_t serial;
+    const uint32_t *pixels;
+};
+
+int                    screen_init   (void);
+void                   screen_exit   (void);
+void                   screen_event  (void);
+void                   screen_start  (int);
+image_info_t          *screen_get    (screen_frame_t *);
+const screen_cursor_t *screen_cursor (void);
@@ -1,6 +1,10 @@
 #include "buffer-static.h"
+#include "event.h"
 #include "netio.h"
 #include "option.h"
+#include "perf.h"
+#include "screen.h"
+#include "source.h"
 #include "token.h"
 #include "tycho-server.h"
 
@@ -11,11 +15,13 @@
 #include "image.h"
 
 #include "input.h"
+#include "xdamage.h"
 #include "xrandr.h"
 
 #include "acl.h"
 #include "ucs_to_keysym.h"
 #include "user.h"
+#include "worker.h"
 
 #include "auth-gss-server.h"
 #include "auth-pam.h"
@@ -54,7 +60,15 @@ struct client {
         buffer_t recv;
     } clipboard, control, gss;
 
-    unsigned image_count;
+    struct {
+        unsigned count;
+        unsigned window;
+        unsigned frames;
+        unsigned latency[CONFIG_IMAGE_LATENCY];
+    } image;
+
+    int events;
+    int readable;
 
     struct {
         buffer_t send;
@@ -65,6 +79,22 @@ struct client {
         uint64_t accept;
     } time;
 
+    struct {
+        perf_t encode;
+        perf_t write;
+        perf_t bytes;
+        perf_t queue;
+        uint64_t written;
+        uint64_t skipped;
+    } perf;
+
+    struct {
+        unsigned rtt;
+        unsigned retrans;
+        uint64_t down;
+        uint64_t clean;
+    } quality;
+
     int close;
 
     client_t *prev, *next;
@@ -72,17 +102,23 @@ struct client {
 
 static struct server_global {
     netio_t netio;
+    int display;
+    int screen;
 
     struct {
         image_t image;
+        uint8_t *rows;
+        int full;
         struct {
             int x, y;
         } pointer;
         struct {
-            XFixesCursorImage *image;
+            screen_cursor_t image;
+            uint32_t *pixels;
             uint32_t hash;
         } cursor;
         uint64_t time;
+        uint64_t analysis;
     } grab;
 
     struct {
@@ -103,10 +139,26 @@ static struct server_global {
         uint64_t timeout;
     } activity;
 
+    struct {
+        perf_t grab;
+        perf_t image;
+        perf_t encode;
+        perf_t write;
+        perf_t bytes;
+        uint64_t frames;
+        uint64_t idle;
+        uint64_t skipped;
+        unsigned period;
+        uint64_t time;
+    } perf;
+
     client_t *clients;
     acl_t *acl;
 
     const char *congestion;
+    int fixed_quality;
+    int source;
+    int multi_login;
     int pam_reinit;
 } global;
 
@@ -139,10 +191,15 @@ client_accept(void)
     global.clients = c;
 
     set_congestion(c->netio.fd, global.congestion);
+    socket_set_int(c->netio.fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, CONFIG_IMAGE_LOWAT);
+
+    c->events = SOCKET_WAIT_R;
+    event_set(c->netio.fd, c->events);
 
     info("%s: accepted\n", c->netio.name);
 
     c->time.accept = time_now();
+    c->image.window = 2;
 
     return c;
 }
@@ -196,6 +253,7 @@ client_close(client_t *c)
 
     client_master_stop(c);
 
+    event_set(c->netio.fd, 0);
     netio_delete(&c->netio);
 
     auth_pam_delete(&c->auth_pam);
@@ -216,48 +274,221 @@ client_close(client_t *c)
 }
 
 static uint32_t
-grab_cursor(void)
+grab_pointer(int x, int y)
 {
-    uint32_t ret = 0;
+    if ((global.grab.pointer.x == x) &&
+        (global.grab.pointer.y == y))
+        return 0;
 
-    XFixesCursorImage *image = XFixesGetCursorImage(display.id);
+    global.grab.pointer.x = x;
+    global.grab.pointer.y = y;
 
-    if (!image)
-        return 0;
+    return (1 << command_pointer);
+}
 
-    if ((global.grab.pointer.x != image->x) ||
-        (global.grab.pointer.y != image->y)) {
-        global.grab.pointer.x = image->x;
-        global.grab.pointer.y = image->y;
-        ret |= (1 << command_pointer);
-    }
+static uint32_t
+grab_cursor_set(const screen_cursor_t *image, const unsigned long *data)
+{
+    const int n = image->w * image->h;
 
+    uint32_t *pixels = safe_calloc(MAX(n, 1), sizeof(uint32_t));
     uint32_t hash = 0;
 
-    for (int i = 0; i < image->height * image->width; i++)
-        hash = (hash << 5) - hash + (uint32_t)image->pixels[i];
+    for (int i = 0; i < n; i++) {
+        pixels[i] = data ? (uint32_t)data[i] : image->pixels[i];
+        hash = (hash << 5) - hash + pixels[i];
+    }
+
+    uint32_t ret = 0;
 
-    if ((!global.grab.cursor.image) ||
+    if ((!global.grab.cursor.pixels) ||
         (hash != global.grab.cursor.hash))
         ret |= (1 << command_cursor);
 
-    if (global.grab.cursor.image)
-        XFree(global.grab.cursor.image);
+    safe_free(global.grab.cursor.pixels);
 
-    global.grab.cursor.image = image;
+    global.grab.cursor.image = *image;
+    global.grab.cursor.image.pixels = pixels;
+    global.grab.cursor.pixels = pixels;
     global.grab.cursor.hash = hash;
 
     return ret;
 }
 
+static uint32_t
+grab_cursor(void)
+{
+    if (global.screen != -1) {
+        const screen_cursor_t *image = screen_cursor();
+
+        uint32_t ret = grab_pointer(image->x, image->y);
+
+        if ((image->pixels) &&
+            ((!global.grab.cursor.pixels) ||
+             (image->serial != global.grab.cursor.image.serial)))
+            ret |= grab_cursor_set(image, NULL);
+
+        return ret;
+    }
+
+    if (!display.id)
+        return 0;
+
+    XFixesCursorImage *image = XFixesGetCursorImage(display.id);
+
+    if (!image)
+        return 0;
+
+    uint32_t ret = grab_pointer(image->x, image->y);
+
+    if ((!global.grab.cursor.pixels) ||
+        (image->cursor_serial != global.grab.cursor.image.serial)) {
+        const screen_cursor_t cursor = {
+            .w = image->width,
+            .h = image->height,
+            .xhot = image->xhot,
+            .yhot = image->yhot,
+            .serial = image->cursor_serial,
+        };
+        ret |= grab_cursor_set(&cursor, image->pixels);
+    }
+
+    XFree(image);
+
+    return ret;
+}
+
+static void
+grab_area(const XRectangle *rects, int count, int w, int h)
+{
+    const int hn = DIV(h, TILE_SIZE);
+
+    uint8_t *const rows = global.grab.rows;
+
+    byte_set(rows, 0, hn);
+
+    for (int k = 0; k < count; k++) {
+        const int y0 = MAX(rects[k].y, 0) / TILE_SIZE;
+        const int y1 = MIN(DIV(rects[k].y + rects[k].height, TILE_SIZE), hn);
+
+        for (int j = y0; j < y1; j++)
+            rows[j] = 1;
+    }
+
+    for (int j = 0; j < hn;) {
+        if (!rows[j]) {
+            j++;
+            continue;
+        }
+
+        int n = j;
+
+        while (n < hn && rows[n])
+            n++;
+
+        const int y = j * TILE_SIZE;
+        const int yh = MIN(n * TILE_SIZE, h) - y;
+
+        int x0 = w, x1 = 0;
+
+        for (int k = 0; k < count; k++) {
+            if ((rects[k].y >= y + yh) ||
+                (rects[k].y + rects[k].height <= y))
+                continue;
+            x0 = MIN(x0, MAX(rects[k].x, 0) / TILE_SIZE * TILE_SIZE);
+            x1 = MAX(x1, DIV(rects[k].x + rects[k].width, TILE_SIZE) * TILE_SIZE);
+        }
+
+        x1 = MIN(x1, w);
+
+        if (x0 < x1)
+            image_get_area(&global.grab.image, x0, y, x1 - x0, yh);
+
+        j = n;
+    }
+}
+
+static uint32_t
+grab_update(image_info_t *image)
+{
+    const uint64_t start = perf_time();
+    const int ret = tycho_set_image(image);
+
+    global.grab.analysis = perf_time() - start;
+    perf_add(&global.perf.image, global.grab.analysis);
+
+    if (!ret) {
+        global.perf.idle++;
+        return 0;
+    }
+
+    global.perf.frames++;
+
+    return (1 << command_image);
+}
+
+static uint32_t
+grab_source(void)
+{
+    source_area_t area;
+
+    const uint64_t start = perf_time();
+    image_info_t *image = source_get(&area);
+
+    if (!image)
+        return 0;
+
+    perf_add(&global.perf.grab, perf_time() - start);
+
+    global.grab.image.info = *image;
+    tycho_set_damage(area.x, area.y, area.w, area.h);
+
+    return grab_update(image);
+}
+
+static uint32_t
+grab_screen(void)
+{
+    screen_frame_t frame;
+
+    screen_start(0);
+
+    image_info_t *image = screen_get(&frame);
+
+    if (!image)
+        return 0;
+
+    perf_add(&global.perf.grab, frame.time);
+
+    for (int k = 0; k < frame.count; k++)
+        tycho_set_damage(frame.area[k].x, frame.area[k].y,
+                         frame.area[k].w, frame.area[k].h);
+
+    if (!tycho_pending())
+        return 0;
+
+    if (frame.time + global.grab.analysis >= CONFIG_GRAB_TIMEOUT * 1000)
+        screen_start(1);
+
+    global.grab.image.info = *image;
+
+    return grab_update(image);
+}
+
 static uint32_t
 grab_image(void)
 {
+    if (global.source)
+        return grab_source();
+
     if (xrandr_resize(global.resize.w, global.resize.h)) {
         XSync(display.id, False);
         return 0;
     }
 
+    if (global.screen != -1)
+        return grab_screen();
+
     int screen = DefaultScreen(display.id);          // XXX
     const int w = DisplayWidth(display.id, screen);  // XXX
     const int h = DisplayHeight(display.id, screen); // XXX
@@ -266,21 +497,167 @@ grab_image(void)
         (global.grab.image.info.h != h)) {
         image_delete(&global.grab.image);
         image_create(&global.grab.image, display.root, w, h);
+        safe_free(global.grab.rows);
+        global.grab.rows = safe_calloc(DIV(h, TILE_SIZE), 1);
+        global.grab.full = 1;
     }
 
+    XRectangle *rects = NULL;
+    int count = xdamage_get(&rects);
+
+    for (int k = 0; k < count; k++)
+        tycho_set_damage(rects[k].x, rects[k].y,
+                         rects[k].width, rects[k].height);
+
+    if (count >= 0 && global.grab.full)
+        tycho_set_damage(0, 0, w, h);
+
+    if (!tycho_pending())
+        return 0;
+
     display.error = 0;
 
-    image_get(&global.grab.image, 0, 0);
+    const uint64_t start = perf_time();
+
+    if (count < 0 || global.grab.full) {
+        image_get(&global.grab.image, 0, 0);
+    } else if (count > 0) {
+        grab_area(rects, count, w, h);
+    }
+
+    if (rects)
+        XFree(rects);
 
     XSync(display.id, False);
 
-    if (display.error)
+    perf_add(&global.perf.grab, perf_time() - start);
+
+    if (display.error) {
+        global.grab.full = 1;
         return 0;
+    }
 
-    if (tycho_set_image(&global.grab.image.info))
-        return (1 << command_image);
+    global.grab.full = 0;
 
-    return 0;
+    return grab_update(&global.grab.image.info);
+}
+
+static int
+grab_timeout(void)
+{
+    if (!global.clients)
+        return -1;
+
+    const uint64_t dt = time_dt(global.grab.time, time_now());
+
+    if (dt >= CONFIG_GRAB_TIMEOUT)
+        return 0;
+
+    return CONFIG_GRAB_TIMEOUT - dt;
+}
+
+static void
+client_quality(client_t *c)
+{
+    struct tcp_info tcpi;
+    socklen_t len = sizeof(tcpi);
+
+    if (!c->access)
+        return;
+
+    if (socket_get(c->netio.fd, SOL_TCP, TCP_INFO, &tcpi, &len) == -1 || !len)
+        return;
+
+    if (!tcpi.tcpi_rtt)
+        return;
+
+    if (!c->quality.rtt || tcpi.tcpi_rtt < c->quality.rtt) {
+        c->quality.rtt = tcpi.tcpi_rtt;
+        c->image.window = CLAMP(DIV(c->quality.rtt, CONFIG_GRAB_TIMEOUT * 1000) + 1,
+                                2, CONFIG_IMAGE_WINDOW);
+    }
+
+    if (global.fixed_quality)
+        return;
+
+    const int congested = tcpi.tcpi_unacked >= tcpi.tcpi_snd_cwnd ||
+                          tcpi.tcpi_total_retrans != c->quality.retrans ||
+                          tcpi.tcpi_rtt > 2 * c->quality.rtt + CONFIG_QUALITY_RTT * 1000;
+
+    c->quality.retrans = tcpi.tcpi_total_retrans;
+
+    const uint64_t now = time_now();
+
+    if (congested) {
+        c->quality.clean = now;
+        if (time_dt(c->quality.down, now) >= CONFIG_QUALITY_DOWN) {
+            c->quality.down = now;
+            c->tycho.quality.drop++;
+            debug("%s: quality drop %u\n", c->netio.name, c->tycho.quality.drop);
+        }
+        return;
+    }
+
+    if (c->tycho.quality.drop && time_dt(c->quality.clean, now) >= CONFIG_QUALITY_UP) {
+        c->quality.clean = now;
+        c->tycho.quality.drop--;
+        debug("%s: quality drop %u\n", c->netio.name, c->tycho.quality.drop);
+        if (c->tycho.quality.skip)
+            c->to_send |= (1 << command_image);
+    }
+}
+
+static void
+client_perf(perf_t *perf, perf_t *all, uint64_t value)
+{
+    perf_add(perf, value);
+    perf_add(all, value);
+}
+
+static char *
+perf_server_str(void)
+{
+    return STR_MAKE(
+        "frames: ", STR_ULL(global.perf.frames), "\n",
+        "idle: ", STR_ULL(global.perf.idle), "\n",
+        "skipped: ", STR_ULL(global.perf.skipped), "\n",
+        perf_str("grab_us", &global.perf.grab), STR_FREE,
+        perf_str("image_us", &global.perf.image), STR_FREE,
+        perf_str("encode_us", &global.perf.encode), STR_FREE,
+        perf_str("write_us", &global.perf.write), STR_FREE,
+        perf_str("bytes", &global.perf.bytes), STR_FREE);
+}
+
+static char *
+perf_client_str(client_t *c)
+{
+    return STR_MAKE(
+        "client: ", c->netio.name, "\n",
+        "skipped: ", STR_ULL(c->perf.skipped), "\n",
+        perf_str("encode_us", &c->perf.encode), STR_FREE,
+        perf_str("write_us", &c->perf.write), STR_FREE,
+        perf_str("bytes", &c->perf.bytes), STR_FREE,
+        perf_str("queue", &c->perf.queue), STR_FREE);
+}
+
+static void
+perf_log(void)
+{
+    if (!global.perf.period ||
+            !time_diff(&global.perf.time, global.perf.period * 1000ULL))
+        return;
+
+    char *data = perf_server_str();
+
+    for (char *line = data; *line;) {
+        char *end = line;
+        while (*end != '\n')
+            end++;
+        info("perf %.*s\n", (int)(end - line), line);
+        line = end + 1;
+    }
+
+    safe_free(data);
 }
 
 static uint32_t
@@ -289,12 +666,17 @@ grab(void)
     if (!time_diff(&global.grab.time, CONFIG_GRAB_TIMEOUT))
         return 0;
 
-    uint32_t to_send = grab_image() | grab_cursor();
+    perf_log();
+
+    uint32_t to_send = grab_image();
+    to_send |= grab_cursor();
 
     for (client_t *c = global.clients; c; c = c->next) {
         if (c->close)
             continue;
 
+        client_quality(c);
+
         if ((c == global.master.client) &&
             (!c->pointer.sx) &&
             (!c->pointer.sy) &&
@@ -312,6 +694,28 @@ grab(void)
     return to_send;
 }
 
+static void
+client_events(client_t *c)
+{
+    int events = SOCKET_WAIT_R;
+
+    if ((buffer_read_size(&c->netio.output)) || (c->netio.tail) ||
+        (c->netio.state & NETIO_READ_WANT_WRITE) ||
+        (c->send.command == command_stop))
+        events |= SOCKET_WAIT_W;
+
+    if ((c->netio.state & NETIO_READY) &&
+        ((c->send.command != command_next) ||
+         (c->to_send & c->send.mask)))
+        events |= SOCKET_WAIT_W;
+
+    if (c->events == events)
+        return;
+
+    c->events = events;
+    event_set(c->netio.fd, events);
+}
+
 static void
 client_access(client_t *c, int access, const char *name)
 {
@@ -324,7 +728,7 @@ client_access(client_t *c, int access, const char *name)
 
     info("%s: access %sed (%s)\n", c->netio.name, access > 0 ? "grant" : "deni", name);
 
-    for (client_t *l = global.clients; l; l = l->next) {
+    for (client_t *l = global.clients; l && !global.multi_login; l = l->next) {
         if (l != c && !str_cmp(l->name, c->name)) {
             l->to_send |= (1 << command_access);
             l->access = 0;
@@ -529,20 +933,30 @@ client_control_version(client_t *c)
     buffer_from_string(&c->control.send, PROG_NAME " " PROG_VERSION);
 }
 
+static client_t *
+client_control_target(client_t *c)
+{
+    char *name = client_control_extract_word(c);
+
+    if (str_cmp(name, "master"))
+        return c;
+
+    if (!global.master.client)
+        buffer_from_string(&c->control.send, "no master");
+
+    return global.master.client;
+}
+
 static void
 client_control_stat(client_t *c)
 {
-    char *name = client_control_extract_word(c);
+    client_t *client = client_control_target(c);
 
-    client_t *client = c;
+    if (!client)
+        return;
 
-    if (!str_cmp(name, "master")) {
-        if (!global.master.client) {
-            buffer_from_string(&c->control.send, "no master");
-            return;
-        }
-        client = global.master.client;
-    }
+    unsigned hit, miss;
+    tycho_cache_stat(&client->tycho, &hit, &miss);
 
     struct tcp_info tcpi;
     socklen_t len = sizeof(tcpi);
@@ -554,6 +968,9 @@ client_control_stat(client_t *c)
 
     char *data = STR_MAKE(
         "client: ", client->netio.name, "\n",
+        "proto: ", client->netio.proto, "\n",
+        "ktls_send: ", STR_ULL(!!(client->netio.state & NETIO_KTLS_SEND)), "\n",
+        "ktls_recv: ", STR_ULL(!!(client->netio.state & NETIO_KTLS_RECV)), "\n",
         "rto: ", STR_ULL(tcpi.tcpi_rto), "\n",
         "ato: ", STR_ULL(tcpi.tcpi_ato), "\n",
         "snd_mss: ", STR_ULL(tcpi.tcpi_snd_mss), "\n",
@@ -572,7 +989,57 @@ client_control_stat(client_t *c)
         "snd_ssthresh: ", STR_ULL(tcpi.tcpi_snd_ssthresh), "\n",
         "snd_cwnd: ", STR_ULL(tcpi.tcpi_snd_cwnd), "\n",
         "advmss: ", STR_ULL(tcpi.tcpi_advmss), "\n",
-        "reordering: ", STR_ULL(tcpi.tcpi_reordering), "\n");
+        "reordering: ", STR_ULL(tcpi.tcpi_reordering), "\n",
+        "cache_hits: ", STR_ULL(hit), "\n",
+        "cache_misses: ", STR_ULL(miss), "\n",
+        "quality_drop: ", STR_ULL(client->tycho.quality.drop), "\n");
+
+    size_t size = str_len(data) + 1;
+    buffer_setup(&c->control.send, data, size);
+    c->control.send.write += size;
+}
+
+static void
+client_control_perf(client_t *c)
+{
+    client_t *client = client_control_target(c);
+
+    if (!client)
+        return;
+
+    char *data = STR_MAKE(perf_server_str(), STR_FREE,
+                          perf_client_str(client), STR_FREE);
+
+    size_t size = str_len(data) + 1;
+    buffer_setup(&c->control.send, data, size);
+    c->control.send.write += size;
+}
+
+static void
+client_control_latency(client_t *c)
+{
+    client_t *client = client_control_target(c);
+
+    if (!client)
+        return;
+
+    char *data = STR_MAKE(
+        "client: ", client->netio.name, "\n",
+        "frames: ", STR_ULL(client->image.frames), "\n",
+        "window: ", STR_ULL(client->image.window), "\n",
+        "inflight: ", STR_ULL(client->image.count), "\n");
+
+    for (unsigned k = 0; k < CONFIG_IMAGE_LATENCY; k++) {
+        if (!client->image.latency[k])
+            continue;
+
+        char *line = STR_MAKE(
+            data, STR_FREE,
+            k + 1 < CONFIG_IMAGE_LATENCY ? "<" : ">=",
+            STR_ULL(k + 1 < CONFIG_IMAGE_LATENCY ? 1u << k : 1u << (k - 1)), "ms: ",
+            STR_ULL(client->image.latency[k]), "\n");
+        data = line;
+    }
 
     size_t size = str_len(data) + 1;
     buffer_setup(&c->control.send, data, size);
@@ -711,6 +1178,8 @@ client_control(client_t *c)
         {"version", client_control_version},
         {"tcp", client_control_stat},
         {"stat", client_control_stat},
+        {"latency", client_control_latency},
+        {"perf", client_control_perf},
 #ifndef NETIO_NO_SSL
         {"key", client_control_key},
 #endif
@@ -729,6 +1198,9 @@ client_control(client_t *c)
 static void
 display_event(void)
 {
+    if (!display.id)
+        return;
+
     while (XPending(display.id)) {
         XEvent event;
         XNextEvent(display.id, &event);
@@ -752,6 +1224,9 @@ display_event(void)
 
         if (xrandr_event(&event))
             continue;
+
+        if (xdamage_event(&event))
+            continue;
     }
 }
 
@@ -785,11 +1260,40 @@ main_init(int argc, char **argv)
     int lock_user = 0;
     unsigned quality_min = CONFIG_QUALITY_MIN;
     unsigned quality_max = CONFIG_QUALITY_MAX;
+    int shared_encode = 0;
+    int range_coder = 0;
+    unsigned block = CONFIG_BLOCK;
+    unsigned run = CONFIG_RUN;
+    unsigned tile_cache = (CONFIG_TILE_CACHE) >> 10;
+    unsigned threads = 1;
+    const char *source = NULL;
+    unsigned source_w = 1920;
+    unsigned source_h = 1080;
+    unsigned source_fps = 30;
 
     option(opt_flag, &lock_user, "lock-user", NULL);
     option(opt_int, &quality_min, "quality-min", NULL);
     option(opt_int, &quality_max, "quality-max", NULL);
+    option(opt_flag, &shared_encode, "shared-encode", NULL);
+    option(opt_flag, &range_coder, "range-coder", NULL);
+    option(opt_int, &block, "block", NULL);
+    option(opt_int, &run, "run", NULL);
+    option(opt_int, &tile_cache, "tile-cache", NULL);
+    option(opt_int, &threads, "threads", NULL);
     option(opt_name, &global.congestion, "congestion", NULL);
+    option(opt_flag, &global.fixed_quality, "fixed-quality", NULL);
+    option(opt_int, &global.perf.period, "perf-log", NULL);
+    option(opt_name, &source, "source", NULL);
+    option(opt_int, &source_w, "source-width", NULL);
+    option(opt_int, &source_h, "source-height", NULL);
+    option(opt_int, &source_fps, "source-fps", NULL);
+    option(opt_flag, &global.multi_login, "multi-login", NULL);
+    int xlib_grab = 0;
+    option(opt_flag, &xlib_grab, "xlib-grab", NULL);
+#ifndef NETIO_NO_SSL
+    int ktls = 0;
+    option(opt_flag, &ktls, "ktls", NULL);
+#endif
 
     option_run(argc, argv);
 
@@ -806,20 +1310,43 @@ main_init(int argc, char **argv)
     openssl_use_dh();
     openssl_use_ecdh(ecdh_curve);
     openssl_use_ciphers(ciphers);
+    openssl_use_ktls(ktls);
     openssl_print_error(NULL); // XXX
 #endif
 
-    display_init();
-    input_init();
-    xrandr_init();
-    clipboard_init(0);
+    global.screen = -1;
 
-    XSelectInput(display.id, display.root, StructureNotifyMask);
+    if (source) {
+        if (source_init(source, source_w, source_h, source_fps))
+            exit(1);
+        global.source = 1;
+        global.display = -1;
+    } else {
+        global.display = display_init();
+        global.screen = xlib_grab ? -1 : screen_init();
+        input_init();
+        xrandr_init();
+        if (global.screen == -1)
+            xdamage_init();
+        clipboard_init(0);
+
+        XSelectInput(display.id, display.root, StructureNotifyMask);
+    }
 
     if (netio_create(&global.netio, host, port, 1) < 0)
         exit(2);
 
     tycho_set_quality(quality_min, quality_max);
+    tycho_set_shared(shared_encode);
+    tycho_set_bands(threads);
+    tycho_set_coder(range_coder ? CODER_RANGE : CODER_BINARY);
+    tycho_set_block(block);
+    tycho_set_run(run);
+    tycho_set_cache((size_t)tile_cache << 10);
+
+    global.perf.time = time_now();
+
+    worker_init(threads);
 
     if (background) {
         switch (fork()) {
@@ -854,9 +1381,15 @@ main_exit()
 
     netio_delete(&global.netio);
     image_delete(&global.grab.image);
+    safe_free(global.grab.rows);
+    safe_free(global.grab.cursor.pixels);
+
+    event_exit();
 
     input_exit();
     display_exit();
+    screen_exit();
+    source_exit();
 #ifndef NETIO_NO_SSL
     openssl_exit();
 #endif
@@ -869,15 +1402,32 @@ main(int argc, char **argv)
     atexit(main_exit);
     main_init(argc, argv);
 
-    int timeout = 1;
+    event_init();
+    event_set(global.netio.fd, SOCKET_WAIT_R);
+    event_set(global.display, SOCKET_WAIT_R);
+    event_set(global.screen, SOCKET_WAIT_R);
+
+    int timeout = -1;
 
     while (running) {
-        if (socket_wait(global.netio.fd, SOCKET_WAIT_R, timeout) > 0)
+        event_timer(grab_timeout());
+
+        if (display.id) {
+            XFlush(display.id);
+
+            if (QLength(display.id))
+                timeout = 0;
+        }
+
+        event_wait(timeout);
+
+        if (event_get(global.netio.fd))
             client_accept();
 
-        timeout = 1;
+        timeout = -1;
 
         display_event();
+        screen_event();
 
         if (global.activity.timeout && global.activity.time &&
             time_dt(global.activity.time, time_now()) > global.activity.timeout) {
@@ -896,10 +1446,21 @@ main(int argc, char **argv)
             buffer_t *const output = &c->netio.output;
             buffer_t *const input = &c->netio.input;
 
-            switch (netio_read(&c->netio)) {
-            case 0: goto client_end;
-            case -1: break;
-            default: timeout = 0;
+            const int events = event_get(c->netio.fd);
+
+            uint8_t *const write = output->write;
+            buffer_t *const tail = c->netio.tail;
+
+            // SSL may hold decrypted data that epoll doesn't report
+            if ((events & SOCKET_WAIT_R) || c->readable ||
+                ((events & SOCKET_WAIT_W) && (c->netio.state & NETIO_READ_WANT_WRITE))) {
+                c->readable = 0;
+
+                switch (netio_read(&c->netio)) {
+                case 0: goto client_end;
+                case -1: break;
+                default: timeout = 0; c->readable = 1;
+                }
             }
 
             while (1) {
@@ -1076,10 +1637,19 @@ main(int argc, char **argv)
 
                 case command_image:
                     {
-                        if (c->image_count)
-                            c->image_count--;
+                        if (buffer_read_size(input) < 4)
+                            goto read_end;
+
+                        const uint32_t stamp = buffer_read_32(input);
+                        const uint32_t dt = (uint32_t)time_now() - stamp;
+
+                        c->image.latency[MIN(dt ? 32 - CLZ(dt) : 0, CONFIG_IMAGE_LATENCY - 1)]++;
+                        c->image.frames++;
+
+                        if (c->image.count)
+                            c->image.count--;
 
-                        if (c->access)
+                        if (c->access && c->image.count < c->image.window)
                             c->send.mask |= (1 << command_image);
 
                         break;
@@ -1245,9 +1815,13 @@ main(int argc, char **argv)
             }
 
         read_end:
-            if (global.master.client == c)
+            if (global.master.client == c && event_expired())
                 grab();
 
+            if (!(events & SOCKET_WAIT_W) && !(c->to_send & c->send.mask) &&
+                (c->send.command != command_start))
+                goto write_end;
+
             while (1) {
                 switch (c->send.command) {
 
@@ -1265,7 +1839,10 @@ main(int argc, char **argv)
                         if (buffer_write_size(output) < 1)
                             goto write_end;
 
-                        const uint32_t send = c->to_send & c->send.mask;
+                        uint32_t send = c->to_send & c->send.mask;
+
+                        if (buffer_read_size(output))
+                            send &= ~(1 << command_image);
 
                         if (send) {
                             c->send.command = CTZ(send);
@@ -1338,19 +1915,19 @@ main(int argc, char **argv)
                         if (buffer_write_size(output) < 12)
                             goto write_end;
 
-                        if (global.grab.cursor.image) {
+                        if (global.grab.cursor.pixels) {
                             uint32_t hash = global.grab.cursor.hash;
 
                             buffer_write_32(output, hash);
 
-                            const unsigned w = global.grab.cursor.image->width;
-                            const unsigned h = global.grab.cursor.image->height;
+                            const unsigned w = global.grab.cursor.image.w;
+                            const unsigned h = global.grab.cursor.image.h;
 
                             buffer_write_16(output, w);
                             buffer_write_16(output, h);
 
-                            buffer_write_16(output, global.grab.cursor.image->xhot);
-                            buffer_write_16(output, global.grab.cursor.image->yhot);
+                            buffer_write_16(output, global.grab.cursor.image.xhot);
+                            buffer_write_16(output, global.grab.cursor.image.yhot);
 
                             if (!hash)
                                 break;
@@ -1373,7 +1950,7 @@ main(int argc, char **argv)
                             buffer_setup(&c->cursor.send, NULL, w * h * 4);
 
                             for (unsigned k = 0; k < w * h; k++)
-                                buffer_write_32(&c->cursor.send, global.grab.cursor.image->pixels[k]);
+                                buffer_write_32(&c->cursor.send, global.grab.cursor.pixels[k]);
 
                         } else { // XXX
                             buffer_write_32(output, 0);
@@ -1402,28 +1979,51 @@ main(int argc, char **argv)
 
                 case command_image:
                     {
-                        if (buffer_write_size(output) < 4)
+                        if (buffer_write_size(output) < 14)
                             goto write_end;
 
-                        buffer_write_16(output, global.grab.image.info.w);
-                        buffer_write_16(output, global.grab.image.info.h);
+                        const unsigned serial = c->tycho.serial;
+                        const uint64_t start = perf_time();
 
                         tycho_setup_server(&c->tycho);
 
-                        c->image_count++;
+                        client_perf(&c->perf.encode, &global.perf.encode, perf_time() - start);
+                        client_perf(&c->perf.bytes, &global.perf.bytes,
+                                    buffer_read_size(tycho_output(&c->tycho)));
+                        perf_add(&c->perf.queue, c->image.count);
+
+                        if (serial && c->tycho.serial > serial + 1) {
+                            c->perf.skipped += c->tycho.serial - serial - 1;
+                            global.perf.skipped += c->tycho.serial - serial - 1;
+                        }
+
+                        buffer_write_16(output, global.grab.image.info.w);
+                        buffer_write_16(output, global.grab.image.info.h);
+                        buffer_write(output, c->tycho.reset);
+                        buffer_write(output, c->tycho.bands);
+                        buffer_write(output, c->tycho.coder);
+                        buffer_write(output, c->tycho.block.size);
+                        buffer_write(output, c->tycho.run);
+                        buffer_write(output, c->tycho.cache.size);
+                        buffer_write_32(output, (uint32_t)time_now());
+
+                        c->image.count++;
                         c->send.command++;
                     }
                     /* FALLTHRU */
 
                 case command_image_data:
                     {
-                        if (tycho_send(&c->tycho, output))
+                        if (netio_send(&c->netio, tycho_output(&c->tycho)))
                             goto write_end;
 
                         if (output->read != output->write)
                             goto write_end;
 
-                        if (c->image_count >= 2)
+                        client_perf(&c->perf.write, &global.perf.write, c->perf.written);
+                        c->perf.written = 0;
+
+                        if (c->image.count >= c->image.window)
                             c->send.mask &= ~(1 << command_image);
 
                         break;
@@ -1462,8 +2062,19 @@ main(int argc, char **argv)
             }
 
         write_end:
-            if (!netio_write(&c->netio))
-                goto client_end;
+            if ((events & SOCKET_WAIT_W) || output->write != write || c->netio.tail != tail ||
+                ((events & SOCKET_WAIT_R) && (c->netio.state & NETIO_WRITE_WANT_READ))) {
+                const uint64_t start = perf_time();
+                const int ret = netio_write(&c->netio);
+
+                if (c->send.command == command_image_data)
+                    c->perf.written += perf_time() - start;
+
+                if (!ret)
+                    goto client_end;
+            }
+
+            client_events(c);
 
             c = c->next;
             continue;
@@ -1472,7 +2083,7 @@ main(int argc, char **argv)
             c = client_close(c);
         }
 
-        if (global.clients && grab())
+        if (global.clients && event_expired() && grab())
             timeout = 0;
     }
 
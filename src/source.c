@@ -0,0 +1,159 @@
+#include "source.h"
+#include "common-static.h"
+#include "desktop.h"
+#include "tga.h"
+
+#define SOURCE_DESKTOP 1
+#define SOURCE_DAMAGE  2
+#define SOURCE_TGA     3
+
+static struct source_global {
+    int type;
+    int desktop;
+    char *path;
+    image_info_t image;
+    unsigned frame;
+    uint64_t time;
+    uint64_t period;
+} global;
+
+static void
+source_desktop(source_area_t *area)
+{
+    desktop_area_t rect = {0};
+
+    desktop_draw(global.desktop, &global.image, global.frame, &rect);
+
+    *area = (source_area_t) {rect.x, rect.y, rect.w, rect.h};
+}
+
+static void
+source_damage(source_area_t *area)
+{
+    image_info_t *const image = &global.image;
+
+    if (!global.frame) {
+        desktop_rect(image, 0, 0, image->w, image->h, 0x305078);
+        *area = (source_area_t) {0, 0, image->w, image->h};
+        return;
+    }
+
+    int x0 = image->w, y0 = image->h, x1 = 0, y1 = 0;
+
+    for (unsigned k = 0; k < CONFIG_SOURCE_RECTS; k++) {
+        const int w = 8 + desktop_rand() % 248;
+        const int h = 16 + desktop_rand() % 240;
+        const int x = desktop_rand() % MAX(image->w - w, 1);
+        const int y = desktop_rand() % MAX(image->h - h, 1);
+
+        if (k & 1) {
+            desktop_rect(image, x, y, w, h, desktop_rand() & 0xFFFFFF);
+        } else {
+            desktop_text(image, x, y, w, h, 0x202020, 0xf8f8f8);
+        }
+
+        x0 = MIN(x0, x);
+        y0 = MIN(y0, y);
+        x1 = MAX(x1, x + w);
+        y1 = MAX(y1, y + h);
+    }
+
+    *area = (source_area_t) {x0, y0, MIN(x1, image->w) - x0, MIN(y1, image->h) - y0};
+}
+
+static int
+source_tga(source_area_t *area)
+{
+    char name[4096];
+    image_info_t image;
+
+    snprintf(name, sizeof(name), "%s-%u.tga", global.path, global.frame);
+
+    if (tga_read(name, &image)) {
+        if (!global.frame)
+            return -1;
+        global.frame = 0;
+        return source_tga(area);
+    }
+
+    safe_free(global.image.data);
+    global.image = image;
+
+    *area = (source_area_t) {0, 0, image.w, image.h};
+
+    return 0;
+}
+
+int
+source_init(const char *name, unsigned w, unsigned h, unsigned fps)
+{
+    if (str_empty(name))
+        return -1;
+
+    global.desktop = desktop_find(name);
+
+    if (global.desktop >= 0) {
+        global.type = SOURCE_DESKTOP;
+    } else if (!str_cmp(name, "damage")) {
+        global.type = SOURCE_DAMAGE;
+    } else if (str_len(name) > 4 && !byte_cmp(name, "tga:", 4)) {
+        global.type = SOURCE_TGA;
+        global.path = STR_MAKE(name + 4);
+    } else {
+        warning("unknown source %s\n", name);
+        return -1;
+    }
+
+    if (global.type != SOURCE_TGA) {
+        global.image.w = CLAMP(w, 256, 8192);
+        global.image.h = CLAMP(h, 256, 8192);
+        global.image.stride = global.image.w;
+        global.image.data = safe_calloc(global.image.w * global.image.h, 4);
+    }
+
+    global.period = 1000 / CLAMP(fps, 1, 1000);
+    global.time = time_now();
+
+    return 0;
+}
+
+void
+source_exit(void)
+{
+    safe_free(global.image.data);
+    safe_free(global.path);
+
+    byte_set(&global, 0, sizeof(global));
+}
+
+image_info_t *
+source_get(source_area_t *area)
+{
+    if (!global.type)
+        return NULL;
+
+    const uint64_t now = time_now();
+
+    if (global.frame && time_dt(global.time, now) < global.period)
+        return NULL;
+
+    global.time = time_dt(global.time, now) < 2 * global.period
+                ? global.time + global.period : now;
+
+    switch (global.type) {
+    case SOURCE_DESKTOP:
+        source_desktop(area);
+        break;
+    case SOURCE_DAMAGE:
+        source_damage(area);
+        break;
+    case SOURCE_TGA:
+        if (source_tga(area))
+            return NULL;
+        break;
+    }
+
+    global.frame++;
+
+    return &global.image;
+}
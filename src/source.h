@@ -0,0 +1,13 @@
+#pragma once
+
+#include "common.h"
+
+typedef struct source_area source_area_t;
+
+struct source_area {
+    int x, y, w, h;
+};
+
+int           source_init (const char *, unsigned, unsigned, unsigned);
+void          source_exit (void);
+image_info_t *source_get  (source_area_t *);
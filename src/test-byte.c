@@ -0,0 +1,78 @@
+#include "common-static.h"
+#include "option.h"
+
+static volatile int sink;
+
+static double
+rate(size_t size, unsigned count, double dt)
+{
+    return dt > 0 ? (double)size * count / dt / (1024 * 1024) : 0;
+}
+
+static void
+bench(size_t size, size_t total)
+{
+    const unsigned n = MAX(total / size, 1);
+    const size_t span = (size <= 65536 ? 64 : 4) * size;
+
+    uint8_t *src = safe_malloc(span);
+    uint8_t *dst = safe_malloc(span);
+
+    for (size_t k = 0; k < span; k++)
+        src[k] = k * 7;
+
+    byte_copy(dst, src, span);
+
+    const size_t mask = (span / size) - 1;
+
+    TINI(0);
+    for (unsigned k = 0; k < n; k++)
+        byte_copy(&dst[(k & mask) * size], &src[(k & mask) * size], size);
+    TINI(1);
+
+    for (unsigned k = 0; k < n; k++)
+        byte_set(&dst[(k & mask) * size], k, size);
+    TINI(2);
+
+    byte_copy(dst, src, span);
+
+    int diff = 0;
+    TINI(3);
+    for (unsigned k = 0; k < n; k++)
+        diff += byte_cmp(&dst[(k & mask) * size], &src[(k & mask) * size], size);
+    TINI(4);
+
+    sink = diff + dst[span - 1];
+
+    info("size=%zu copy=%.0fMB/s set=%.0fMB/s cmp=%.0fMB/s\n", size,
+         rate(size, n, TDIF(0, 1)),
+         rate(size, n, TDIF(1, 2)),
+         rate(size, n, TDIF(3, 4)));
+
+    safe_free(src);
+    safe_free(dst);
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t total = 1024;
+    size_t size = 0;
+
+    option(opt_int, &total, "total", "megabytes processed per size");
+    option(opt_int, &size, "size", "only bench this size (in bytes)");
+    option_run(argc, argv);
+
+    total <<= 20;
+
+    if (size) {
+        bench(size, total);
+        return 0;
+    }
+
+    bench(64, total);
+    bench(16 * 1024, total);
+    bench(4 * 1024 * 1024, total);
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include "core-client.h"
+#include "event.h"
+#include "option.h"
+#include "perf.h"
+#include "worker.h"
+
+#ifndef NETIO_NO_SSL
+#include "auth-ssl.h"
+#endif
+
+typedef struct load load_t;
+
+struct load {
+    core_client_t core;
+    int auth;
+    int closed;
+    uint64_t frames;
+    perf_t latency;
+};
+
+static struct {
+    const char *user;
+    const char *pass;
+} global;
+
+static int
+load_auth(load_t *load)
+{
+    switch (load->auth++) {
+    case 0:
+#ifndef NETIO_NO_SSL
+        core_send(&load->core, command_auth_ssl);
+        return 1;
+    case 1:
+#endif
+        if (!global.user || !global.pass)
+            break;
+        core_send_auth(&load->core, global.user, global.pass);
+        return 1;
+    }
+
+    warning("%s: authentication failed\n", load->core.netio.name);
+
+    return 0;
+}
+
+static int
+load_image(core_client_t *core)
+{
+    if (core->drop || core->size.w <= 0 || core->size.h <= 0 ||
+        (core->size.w == core->image.w && core->size.h == core->image.h))
+        return 0;
+
+    safe_free(core->image.data);
+
+    core->image.w = core->size.w;
+    core->image.h = core->size.h;
+    core->image.stride = core->size.w;
+    core->image.data = safe_calloc(core->image.h * core->image.stride, 4);
+
+    return 1;
+}
+
+static int
+load_recv(load_t *load)
+{
+    core_client_t *const core = &load->core;
+
+    while (1) {
+        int ret = core_recv_all(core);
+
+        if (core_received(core, command_start) && !load_auth(load))
+            return 0;
+
+        if (core_received(core, command_access)) {
+            if (!core->level) {
+                if (!load_auth(load))
+                    return 0;
+            } else if (core->access <= 0) {
+                warning("%s: access denied\n", core->netio.name);
+                return 0;
+            } else {
+                core_send(core, command_access);
+            }
+        }
+
+        if (core_received(core, command_image_data)) {
+            load->frames++;
+            perf_add(&load->latency, (uint32_t)time_now() - core->image_stamp);
+        }
+
+        safe_free(core_recv_control(core));
+        safe_free(core_recv_clipboard(core));
+
+        if (!ret)
+            return 0;
+
+        if (!load_image(core))
+            return 1;
+    }
+}
+
+static double
+rate(uint64_t value, uint64_t ms)
+{
+    return ms ? (double)value * 1000 / ms : 0;
+}
+
+static void
+load_report(load_t *load, unsigned count, uint64_t ms)
+{
+    perf_t latency = {0};
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        const perf_t *const perf = &load[i].latency;
+
+        print("client=%u frames=%llu fps=%.1f bytes=%llu closed=%i "
+              "latency_p50=%llu latency_p99=%llu latency_max=%llu\n",
+              i, (unsigned long long)load[i].frames, rate(load[i].frames, ms),
+              (unsigned long long)load[i].core.received, load[i].closed,
+              (unsigned long long)perf_get(perf, 50),
+              (unsigned long long)perf_get(perf, 99),
+              (unsigned long long)perf->max);
+
+        for (unsigned k = 0; k < PERF_BUCKETS; k++)
+            latency.bucket[k] += perf->bucket[k];
+
+        latency.count += perf->count;
+        latency.max = MAX(latency.max, perf->max);
+
+        frames += load[i].frames;
+        bytes += load[i].core.received;
+    }
+
+    print("clients=%u time=%llums frames=%llu fps=%.1f bytes=%llu egress=%.2fMB/s "
+          "latency_p50=%llu latency_p99=%llu latency_max=%llu\n",
+          count, (unsigned long long)ms, (unsigned long long)frames,
+          rate(frames, ms) / count, (unsigned long long)bytes,
+          rate(bytes, ms) / 1e6,
+          (unsigned long long)perf_get(&latency, 50),
+          (unsigned long long)perf_get(&latency, 99),
+          (unsigned long long)latency.max);
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *host = NULL;
+    const char *port = CONFIG_PORT;
+    unsigned count = 4;
+    unsigned duration = 10;
+    unsigned threads = 0;
+    int drop = 0;
+
+    option(opt_host, &host, NULL, NULL);
+    option(opt_port, &port, NULL, NULL);
+    option(opt_port, &port, "port", "port to connect on the remote host");
+    option(opt_int, &count, "clients", "number of concurrent connections");
+    option(opt_int, &duration, "duration", "test duration (in seconds)");
+    option(opt_name, &global.user, "user", "login used if not trusted");
+    option(opt_str, &global.pass, "password", "password used if not trusted");
+    option(opt_flag, &drop, "dont-decode", "receive frames without decoding them");
+    option(opt_int, &threads, "threads", NULL);
+    option_run(argc, argv);
+
+    if (!count)
+        return 0;
+
+    common_init();
+    socket_init();
+    worker_init(threads);
+    event_init();
+
+#ifndef NETIO_NO_SSL
+    openssl_init();
+
+    auth_ssl_load(0);
+    auth_ssl_setup_rsa(CONFIG_SSL_RSA_LEN, CONFIG_SSL_RSA_EXP);
+#endif
+
+    load_t *load = safe_calloc(count, sizeof(load_t));
+
+    for (unsigned i = 0; i < count; i++) {
+        if (!core_create(&load[i].core, host, port))
+            return 2;
+
+        load[i].core.drop = drop;
+        event_set(load[i].core.netio.fd, SOCKET_WAIT_R);
+    }
+
+    const uint64_t start = time_now();
+    uint64_t ms = 0;
+    unsigned active = count;
+
+    while (running && active && ms < duration * 1000ULL) {
+        int decode = 0;
+
+        for (unsigned i = 0; i < count; i++)
+            decode |= !load[i].closed && load[i].core.decode;
+
+        event_wait(decode ? 1 : 10);
+
+        for (unsigned i = 0; i < count; i++) {
+            core_client_t *const core = &load[i].core;
+
+            if (load[i].closed)
+                continue;
+
+            if (load_recv(&load[i]) && core_send_all(core))
+                continue;
+
+            event_set(core->netio.fd, 0);
+            load[i].closed = 1;
+            active--;
+        }
+
+        ms = time_now() - start;
+    }
+
+    load_report(load, count, ms);
+
+    tycho_recv_wait(NULL);
+
+    for (unsigned i = 0; i < count; i++) {
+        safe_free(load[i].core.image.data);
+        core_delete(&load[i].core);
+    }
+
+    safe_free(load);
+
+    event_exit();
+#ifndef NETIO_NO_SSL
+    openssl_exit();
+#endif
+    socket_exit();
+
+    return 0;
+}
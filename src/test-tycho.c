@@ -1,32 +1,41 @@
 #include "buffer-static.h"
+#include "desktop.h"
 #include "option.h"
+#include "perf.h"
 #include "tga.h"
 #include "tycho-client.h"
 #include "tycho-server.h"
+#include "worker.h"
 
-static uint32_t
-pcg32(void)
-{
-    static uint64_t s = 159;
-    const uint32_t a = ((s >> 18u) ^ s) >> 27u;
-    const uint32_t b = s >> 59u;
-    s = s * 6364136223846793005ULL + 15726070495360670683ULL;
-    return (a >> b) | (a << ((-b) & 31));
-}
+static desktop_area_t area;
 
 static int
-image_random(image_info_t *image, _unused_ int i)
+image_random(image_info_t *image, int i, int change)
 {
     if (!image->data) {
         image->data = safe_malloc(image->w * image->h * 4);
         image->stride = image->w;
     }
 
-    for (int j = 0; j < image->h; j++) {
-        for (int i = 0; i < image->w; i++)
-            image->data[j * image->stride + i] = pcg32() & 0xFFFFFF;
+    int x = 0, y = 0, w = image->w, h = image->h;
+
+    if (i && change < 100) {
+        w = image->w * change / 100;
+        h = image->h * change / 100;
+        x = w < image->w ? desktop_rand() % (image->w - w + 1) : 0;
+        y = h < image->h ? desktop_rand() % (image->h - h + 1) : 0;
     }
 
+    for (int j = y; j < y + h; j++) {
+        for (int i = x; i < x + w; i++)
+            image->data[j * image->stride + i] = desktop_rand() & 0xFFFFFF;
+    }
+
+    area.x = x;
+    area.y = y;
+    area.w = w;
+    area.h = h;
+
     return 0;
 }
 
@@ -51,6 +60,185 @@ image_tga(image_info_t *image, const char *filename, int i)
     return 0;
 }
 
+static int
+tile_diff(const image_info_t *a, int xa, int ya,
+          const image_info_t *b, int xb, int yb, int w, int h)
+{
+    if (xb < 0 || yb < 0 || xb + w > b->w || yb + h > b->h)
+        return 1;
+
+    for (int j = 0; j < h; j++) {
+        if (byte_cmp(&a->data[(ya + j) * a->stride + xa],
+                     &b->data[(yb + j) * b->stride + xb], w * 4))
+            return 1;
+    }
+
+    return 0;
+}
+
+static void
+bench_check(const char *name, int frame, const tycho_t *tycho,
+            image_info_t *output, const image_info_t *prev, uint8_t *copied)
+{
+    tycho_tiles_t *const tiles = tycho_get_tiles();
+
+    uint32_t data[TILE_SIZE * TILE_SIZE];
+
+    for (unsigned j = 0; j < tiles->hn; j++) {
+        for (unsigned i = 0; i < tiles->wn; i++) {
+            const unsigned k = j * tiles->wn + i;
+            const int x = i * TILE_SIZE;
+            const int y = j * TILE_SIZE;
+
+            image_info_t tile = {
+                .data = data,
+                .w = MIN(TILE_SIZE, output->w - x),
+                .h = MIN(TILE_SIZE, output->h - y),
+                .stride = TILE_SIZE,
+            };
+
+            tycho_draw_tile(&tiles->tile[k], &tile);
+
+            if (!tile_diff(output, x, y, &tile, 0, 0, tile.w, tile.h)) {
+                copied[k] = 0;
+                continue;
+            }
+
+            if (tycho->move.w &&
+                x >= tycho->move.x && x < tycho->move.x + tycho->move.w &&
+                y >= tycho->move.y && y < tycho->move.y + tycho->move.h &&
+                !tile_diff(output, x, y, prev, x + tycho->move.dx, y + tycho->move.dy,
+                           tile.w, tile.h)) {
+                copied[k] = 1;
+                continue;
+            }
+
+            if (copied[k] && !tile_diff(output, x, y, prev, x, y, tile.w, tile.h))
+                continue;
+
+            error("workload %s: tile %u,%u of frame %i does not match the encoder\n",
+                  name, i, j, frame);
+        }
+    }
+}
+
+static void
+bench_run(unsigned workload, image_info_t *image, int count, size_t size, int damage)
+{
+    const char *const name = desktop_name(workload);
+
+    buffer_t buffer;
+    buffer_setup(&buffer, NULL, size);
+
+    tycho_t encode = {0};
+    tycho_t decode = {0};
+
+    image_info_t output = {
+        .data = safe_calloc(image->w * image->h, 4),
+        .w = image->w,
+        .h = image->h,
+        .stride = image->w,
+    };
+
+    image_info_t prev = output;
+    prev.data = safe_malloc(image->w * image->h * 4);
+
+    uint8_t *copied = safe_calloc(DIV(image->w, TILE_SIZE) * DIV(image->h, TILE_SIZE), 1);
+
+    perf_t encode_us = {0};
+    perf_t decode_us = {0};
+
+    double encode_total = 0.0;
+    double decode_total = 0.0;
+    double raw_total = 0.0;
+    double size_total = 0.0;
+    int frames = 0;
+
+    for (int i = 0; i < count; i++) {
+        desktop_draw(workload, image, i, &area);
+
+        TINI(0);
+
+        if (damage)
+            tycho_set_damage(area.x, area.y, area.w, area.h);
+
+        const int update = tycho_pending() ? tycho_set_image(image) : 0;
+
+        if (update) {
+            tycho_setup_server(&encode);
+            while (tycho_send(&encode, &buffer))
+                buffer_resize(&buffer, buffer_size(&buffer) << 1);
+        }
+
+        TINI(1);
+
+        if (update) {
+            byte_copy(prev.data, output.data, image->w * image->h * 4);
+            tycho_setup(&decode, image->w, image->h, encode.bands, encode.coder,
+                        encode.block.size, encode.run, encode.cache.size);
+            if (encode.reset)
+                tycho_reset(&decode);
+            if (tycho_recv(&decode, &buffer, &output))
+                error("incomplete frame\n");
+        }
+
+        TINI(2);
+
+        if (buffer_read_size(&buffer))
+            error("decode error\n");
+
+        const size_t bytes = buffer.write - buffer.data;
+
+        buffer_format(&buffer);
+
+        if (!update)
+            continue;
+
+        bench_check(name, i, &encode, &output, &prev, copied);
+
+        perf_add(&encode_us, TDIF(0, 1) * 1e6);
+        perf_add(&decode_us, TDIF(1, 2) * 1e6);
+
+        encode_total += TDIF(0, 1);
+        decode_total += TDIF(1, 2);
+        raw_total += (double)image->w * image->h * 4;
+        size_total += bytes;
+        frames++;
+    }
+
+    if (frames && encode_total > 0 && decode_total > 0)
+        print("workload=%s frames=%i bytes/frame=%.0f ratio=%.2f "
+              "encode=%.2fMB/s decode=%.2fMB/s "
+              "encode_p50=%llu encode_p99=%llu decode_p50=%llu decode_p99=%llu\n",
+              name, frames, size_total / frames, size_total ? raw_total / size_total : 0.0,
+              raw_total / encode_total / 1e6, raw_total / decode_total / 1e6,
+              (unsigned long long)perf_get(&encode_us, 50),
+              (unsigned long long)perf_get(&encode_us, 99),
+              (unsigned long long)perf_get(&decode_us, 50),
+              (unsigned long long)perf_get(&decode_us, 99));
+
+    tycho_delete(&encode);
+    tycho_delete(&decode);
+    safe_free(output.data);
+    safe_free(prev.data);
+    safe_free(copied);
+    safe_free(buffer.data);
+}
+
+static void
+bench(image_info_t *image, const char *name, int count, size_t size, int damage)
+{
+    image->data = safe_malloc(image->w * image->h * 4);
+    image->stride = image->w;
+
+    for (unsigned k = 0; desktop_name(k); k++) {
+        if (!name || !str_cmp(name, desktop_name(k)))
+            bench_run(k, image, count, size, damage);
+    }
+
+    safe_free(image->data);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -67,9 +255,23 @@ main(int argc, char **argv)
     unsigned min = CONFIG_QUALITY_MIN;
     unsigned max = CONFIG_QUALITY_MAX;
 
+    int clients = 1;
+    int shared = 0;
+    int drop = 0;
+    int range = 0;
+    int block = CONFIG_BLOCK;
+    int run = CONFIG_RUN;
+    int tile_cache = (CONFIG_TILE_CACHE) >> 10;
+    int threads = 1;
+    int change = 100;
+    int damage = 0;
+
     int dont_decode = 0;
     char *dump = NULL;
 
+    int bench_count = 0;
+    char *bench_name = NULL;
+
     // tga
     option(opt_file, &filename, NULL, NULL);
 
@@ -78,80 +280,200 @@ main(int argc, char **argv)
     option(opt_int, &image.h, "height", "");
 
     option(opt_int, &count, "count", "");
+    option(opt_int, &change, "change", "");
+    option(opt_flag, &damage, "damage", "");
 
     option(opt_int, &min, "quality-min", "");
     option(opt_int, &max, "quality-max", "");
 
+    option(opt_int, &clients, "clients", "");
+    option(opt_flag, &shared, "shared-encode", "");
+    option(opt_int, &drop, "quality-drop", "");
+    option(opt_int, &threads, "threads", "");
+    option(opt_flag, &range, "range-coder", "");
+    option(opt_int, &block, "block", "");
+    option(opt_int, &run, "run", "");
+    option(opt_int, &tile_cache, "tile-cache", "");
+
     option(opt_flag, &dont_decode, "dont-decode", "");
     option(opt_file, &dump, "dump", "");
     option(opt_int, &size, "size", "");
 
+    option(opt_int, &bench_count, "bench", "");
+    option(opt_name, &bench_name, "workload", "");
+
     option_run(argc, argv);
 
+    if (clients < 1)
+        clients = 1;
+
+    if (change < 0)
+        change = 0;
+
+    if (change > 100)
+        change = 100;
+
     tycho_set_quality(min, max);
+    tycho_set_shared(shared);
+    tycho_set_bands(threads);
+    tycho_set_coder(range ? CODER_RANGE : CODER_BINARY);
+    tycho_set_block(block);
+    tycho_set_run(run);
+    tycho_set_cache((size_t)MAX(tile_cache, 0) << 10);
+
+    worker_init(threads);
+
+    if (bench_count > 0) {
+        bench(&image, bench_name, bench_count, size, damage);
+        return 0;
+    }
 
-    buffer_t buffer;
-    buffer_setup(&buffer, safe_malloc(size), size);
+    buffer_t *buffer = safe_calloc(clients, sizeof(buffer_t));
 
-    tycho_t tycho_encode;
-    byte_set(&tycho_encode, 0, sizeof(tycho_t));
+    for (int k = 0; k < clients; k++)
+        buffer_setup(&buffer[k], safe_malloc(size), size);
 
-    tycho_t tycho_decode;
-    byte_set(&tycho_decode, 0, sizeof(tycho_t));
+    tycho_t *tycho_encode = safe_calloc(clients, sizeof(tycho_t));
+    tycho_t *tycho_decode = safe_calloc(clients, sizeof(tycho_t));
+
+    tycho_encode[clients - 1].quality.drop = MAX(drop, 0);
+
+    image_info_t output = {0};
 
     int dumpfd = safe_open(dump, O_CREAT | O_TRUNC | O_WRONLY, 0640);
 
     int progress = isatty(1) && !isatty(2);
 
-    for (int i = 0; i < count; i++) {
+    double cpu_total = 0.0;
+    double encode_total = 0.0;
+    double decode_total = 0.0;
+    double scan_total = 0.0;
+    double raw_total = 0.0;
+    double size_total = 0.0;
+    int frames = 0;
+
+    int i;
+
+    for (i = 0; i < count; i++) {
         if (progress)
             print(" %i\r", i);
 
         int ret = filename ? image_tga(&image, filename, i)
-                           : image_random(&image, i);
+                           : image_random(&image, i, change);
 
         if (ret)
             break;
 
+        if (output.w != image.w || output.h != image.h) {
+            safe_free(output.data);
+            output.data = safe_malloc(image.w * image.h * 4);
+            output.stride = image.w;
+            output.w = image.w;
+            output.h = image.h;
+        }
+
         TINI(0);
 
-        int update = tycho_set_image(&image);
+        if (damage && !filename)
+            tycho_set_damage(area.x, area.y, area.w, area.h);
+
+        int update = tycho_pending() ? tycho_set_image(&image) : 0;
 
         TINI(1);
 
+        const clock_t cpu = clock();
+
         if (update) {
-            tycho_setup_server(&tycho_encode);
-            tycho_send(&tycho_encode, &buffer);
+            for (int k = 0; k < clients; k++) {
+                tycho_setup_server(&tycho_encode[k]);
+                if (tycho_encode[k].quality.drop && !tycho_encode[k].redraw &&
+                    !tycho_encode[k].quality.limit)
+                    error("client %i ignores its quality drop\n", k);
+                while (tycho_send(&tycho_encode[k], &buffer[k]))
+                    buffer_resize(&buffer[k], buffer_size(&buffer[k]) << 1);
+            }
         }
 
-        size_t size = buffer_read_size(&buffer);
+        const double cpu12 = (double)(clock() - cpu) / CLOCKS_PER_SEC;
+
+        size_t size = buffer_read_size(&buffer[0]);
 
         if (size && dumpfd != -1) {
-            if (safe_write(dumpfd, buffer.read, size) != size)
+            if (safe_write(dumpfd, buffer[0].read, size) != size)
                 warning("dump write error\n");
         }
 
         TINI(2);
 
         if (update && !dont_decode) {
-            tycho_setup(&tycho_decode, image.w, image.h);
-            tycho_recv(&tycho_decode, &buffer, &image);
+            for (int k = 0; k < clients; k++) {
+                tycho_setup(&tycho_decode[k], image.w, image.h,
+                            tycho_encode[k].bands, tycho_encode[k].coder,
+                            tycho_encode[k].block.size, tycho_encode[k].run,
+                            tycho_encode[k].cache.size);
+                if (tycho_encode[k].reset)
+                    tycho_reset(&tycho_decode[k]);
+                tycho_recv(&tycho_decode[k], &buffer[k], &output);
+            }
         }
 
         TINI(3);
 
-        if (!dont_decode && buffer_read_size(&buffer))
-            error("decode error\n");
+        for (int k = 0; k < clients; k++) {
+            if (!dont_decode && buffer_read_size(&buffer[k]))
+                error("decode error\n");
+            buffer_format(&buffer[k]);
+        }
 
         double time01 = TDIF(0, 1);
         double time12 = TDIF(1, 2);
         double time23 = TDIF(2, 3);
 
-        info("%i %f %f %f %f %i\n", update, time01, time12, time01 + time12, time23, size);
+        if (clients > 1) {
+            info("%i %f %f %f %f %i %f\n", update, time01, time12, time01 + time12, time23, size, cpu12);
+        } else {
+            info("%i %f %f %f %f %i\n", update, time01, time12, time01 + time12, time23, size);
+        }
 
-        buffer_format(&buffer);
+        scan_total += time01;
+
+        if (update) {
+            cpu_total += cpu12;
+            encode_total += time12;
+            decode_total += time23;
+            raw_total += (double)image.w * image.h * 4;
+            size_total += size;
+            frames++;
+        }
     }
 
+    if (i)
+        info("scan/frame=%f updates=%i/%i\n", scan_total / i, frames, i);
+
+    if (frames)
+        info("threads=%u encode/frame=%f decode/frame=%f\n",
+             worker_count(), encode_total / frames, decode_total / frames);
+
+    if (frames && size_total)
+        info("coder=%s block=%u run=%u bytes/frame=%.0f ratio=%.2f encode=%.2fMB/s decode=%.2fMB/s\n",
+             range ? "range" : "binary", TILE_SIZE << tycho_encode[0].block.size,
+             tycho_encode[0].run,
+             size_total / frames, raw_total / size_total,
+             size_total / encode_total / 1e6, size_total / decode_total / 1e6);
+
+    unsigned hit, miss;
+
+    tycho_cache_stat(&tycho_encode[0], &hit, &miss);
+
+    if (hit + miss)
+        info("cache=%u hits=%u misses=%u rate=%.2f%%\n",
+             tycho_encode[0].cache.size ? 1u << tycho_encode[0].cache.size : 0,
+             hit, miss, 100.0 * hit / (hit + miss));
+
+    if (clients > 1 && frames)
+        info("clients=%i shared=%i cpu/frame=%f cpu/frame/client=%f\n",
+             clients, shared, cpu_total / frames, cpu_total / frames / clients);
+
     safe_close(dumpfd);
 
     return 0;
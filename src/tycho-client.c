@@ -1,39 +1,64 @@
 #include "tycho-client.h"
 #include "color-static.h"
 #include "tycho-static.h"
+#include "worker.h"
+
+static struct tycho_client_global {
+    tycho_t *decode;
+} global;
 
 static int
-buffer_read_tile(tycho_t *const restrict tycho,
+buffer_read_tile(tycho_band_t *const restrict band,
                  buffer_t *const restrict buffer,
-                 tycho_tile_t *const restrict tile)
+                 tycho_tile_t *const restrict tile,
+                 tycho_cache_t *const restrict cache)
 
 {
-    tycho_state_t st = tycho->state;
+    tycho_state_t st = band->state;
 
     if (!st.count) {
         uint8_t count;
-        if (decode(&tycho->coder, buffer, &tycho->count.model, &count, 4, tycho->count.ctx))
+        if (decode(&band->coder, buffer, &band->count.model, &count, 4, band->count.ctx))
             goto save_state;
-        tycho->count.ctx = ((tycho->count.ctx << 4) | count) & 0xFFF;
+        band->count.ctx = ((band->count.ctx << 4) | count) & 0xFFF;
         if (!count)
             return -1;
-        tile->count = count;
+        if (count == TILE_COPY)
+            return 2;
+        if (count > COLOR_MAX && (count != TILE_CACHE || !cache))
+            return -1;
+        if (count <= COLOR_MAX)
+            tile->count = count;
         byte_set(&st, 0, sizeof(st));
         st.i = 1;
         st.count = count;
     }
 
+    if (st.count == TILE_CACHE) {
+        for (; st.k < 2; st.k++) {
+            uint8_t c;
+            if (decode(&band->coder, buffer, &band->slot.model, &c, 8, 0))
+                goto save_state;
+            st.slot = (st.slot << 8) | c;
+        }
+        const unsigned slot = st.slot & (cache->size - 1);
+        byte_copy(tile, &cache->tile[slot], sizeof(tycho_tile_t));
+        cache_use(cache, slot);
+        cache->hit++;
+        band->state.count = 0;
+        return 0;
+    }
+
     for (; st.k < st.count * 3; st.k++) {
         uint8_t c;
-        if (decode(&tycho->coder, buffer, &tycho->color[st.k % 3].model, &c, 8, tycho->color[st.k % 3].ctx))
+        if (decode(&band->coder, buffer, &band->color[st.k % 3].model, &c, 8, band->color[st.k % 3].ctx))
             goto save_state;
-        tycho->color[st.k % 3].ctx = c;
+        band->color[st.k % 3].ctx = c;
         tile->color[st.k] = c;
     }
 
     if _1_(st.count > 1) {
-        static const int lg[] = {1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4};
-        tycho_model_t *const restrict model = tycho->index.model;
+        tycho_model_t *const restrict model = band->index.model;
         for (; st.j < TILE_SIZE; st.j++) {
             for (; st.i < TILE_SIZE; st.i++) {
                 uint8_t p;
@@ -44,7 +69,7 @@ buffer_read_tile(tycho_t *const restrict tycho,
                     ctx |= tile->index[st.j * TILE_SIZE + st.i - TILE_SIZE] << 4;
                 if (st.i && st.j)
                     ctx |= tile->index[st.j * TILE_SIZE + st.i - TILE_SIZE - 1] << 8;
-                if (decode(&tycho->coder, buffer, &model[st.pmax], &p, lg[st.pmax], ctx))
+                if (decode(&band->coder, buffer, &model[st.pmax], &p, model[st.pmax].bits, ctx))
                     goto save_state;
                 tile->index[st.j * TILE_SIZE + st.i] = p;
                 if (st.pmax < p)
@@ -54,11 +79,16 @@ buffer_read_tile(tycho_t *const restrict tycho,
         }
     }
 
-    tycho->state.count = 0;
+    if (cache) {
+        cache_add(cache, tile, 0);
+        cache->miss++;
+    }
+
+    band->state.count = 0;
     return 0;
 
 save_state:
-    tycho->state = st;
+    band->state = st;
     return 1;
 }
 
@@ -95,41 +125,286 @@ draw_tile(tycho_tile_t *const restrict tile,
     }
 }
 
-int
-tycho_recv(tycho_t *tycho, buffer_t *buffer, image_info_t *image)
+static void
+move_tile(const tycho_t *const restrict tycho,
+          image_info_t *const restrict image,
+          int x, int y)
+{
+    const image_info_t *const move = &tycho->move.image;
+
+    x -= tycho->move.x;
+    y -= tycho->move.y;
+
+    if (x < 0 || y < 0 || x + image->w > move->w || y + image->h > move->h)
+        return;
+
+    for (int j = 0; j < image->h; j++)
+        byte_copy(&image->data[j * image->stride],
+                  &move->data[(y + j) * move->stride + x], image->w * 4);
+}
+
+static void
+move_setup(tycho_t *const restrict tycho,
+           const image_info_t *const restrict image)
+{
+    image_info_t *const move = &tycho->move.image;
+
+    const int x = tycho->move.x + tycho->move.dx;
+    const int y = tycho->move.y + tycho->move.dy;
+
+    if (!tycho->move.w || x < 0 || y < 0 ||
+            x + tycho->move.w > image->w || y + tycho->move.h > image->h) {
+        move->w = 0;
+        move->h = 0;
+        return;
+    }
+
+    if (move->stride * move->h < tycho->move.w * tycho->move.h) {
+        safe_free(move->data);
+        move->data = safe_malloc(tycho->move.w * tycho->move.h * 4);
+    }
+
+    move->w = tycho->move.w;
+    move->h = tycho->move.h;
+    move->stride = move->w;
+
+    for (int j = 0; j < move->h; j++)
+        byte_copy(&move->data[j * move->stride],
+                  &image->data[(y + j) * image->stride + x], move->w * 4);
+}
+
+static int
+run_read(tycho_band_t *const restrict band,
+         buffer_t *const restrict buffer)
+{
+    if (!band->step) {
+        uint8_t c;
+        if (decode(&band->coder, buffer, &band->run.model, &c, 5, band->run.ctx))
+            return 1;
+        band->run.ctx = c;
+        band->skip = 0;
+        band->step = 1;
+    }
+
+    const unsigned c = band->run.ctx;
+    const unsigned q = DIV(c, 4);
+
+    for (; band->step <= q; band->step++) {
+        uint8_t v;
+        if (decode(&band->coder, buffer, &band->span.model, &v, 4, band->step == 1 ? c : 0))
+            return 1;
+        band->skip = (band->skip << 4) | v;
+    }
+
+    band->skip = ((1u << c) | band->skip) - 1;
+    band->step = 0;
+    return 0;
+}
+
+static int
+band_recv(tycho_band_t *const restrict band,
+          tycho_t *const restrict tycho,
+          buffer_t *const restrict buffer,
+          image_info_t *const restrict image)
 {
     const unsigned wn = tycho->tiles.wn;
-    const unsigned hn = tycho->tiles.hn;
 
     const unsigned w = image->w;
     const unsigned h = image->h;
 
-    if (tycho->flush) {
-        if (decoder_flush(&tycho->coder, buffer))
+    tycho_cache_t *const cache = tycho->cache.use && band->cache.size ? &band->cache : NULL;
+
+    if (band->flush) {
+        if (decoder_flush(&band->coder, buffer))
             return 1;
-        tycho->flush = 0;
+        band->flush = 0;
     }
 
-    for (unsigned j = tycho->tile / wn; j < hn; j++) {
-        for (unsigned i = tycho->tile % wn; i < wn; i++) {
-            int ret = buffer_read_tile(tycho, buffer, &tycho->tiles.tile[tycho->tile]);
+    const unsigned mask = (1u << tycho->block.size) - 1;
 
+    for (; band->tile < band->end; band->tile++) {
+        const unsigned j = band->tile / wn;
+        const unsigned i = band->tile % wn;
+
+        tycho_tile_t *const tile = &tycho->tiles.tile[band->tile];
+        uint8_t mode = BLOCK_SPLIT;
+        int origin = 1;
+
+        if (tycho->block.size) {
+            origin = !((j | i) & mask);
+
+            if (origin && !band->origin) {
+                uint8_t m;
+                if (decode(&band->coder, buffer, &band->block.model, &m, 2, band->block.ctx))
+                    return 1;
+                band->block.ctx = m;
+                *block_mode(tycho, j, i) = m;
+                band->origin = 1;
+            }
+
+            mode = *block_mode(tycho, j, i);
+        }
+
+        if (tycho->run && mode == BLOCK_SPLIT) {
+            if (!band->gap) {
+                if (run_read(band, buffer))
+                    return 1;
+                band->gap = 1;
+            }
+            if (band->skip && !tycho->block.size) {
+                band->tile += MIN(band->skip, band->end - band->tile) - 1;
+                band->skip = 0;
+                continue;
+            }
+        }
+
+        int ret = -1;
+
+        if (mode == BLOCK_UNIFORM && !origin) {
+            const tycho_tile_t *const first = &tycho->tiles.tile[(j & ~mask) * wn + (i & ~mask)];
+            tile->count = 1;
+            byte_copy(tile->color, first->color, 3);
+            ret = 0;
+        } else if (mode == BLOCK_SPLIT && band->skip) {
+            band->skip--;
+        } else if (mode != BLOCK_UNCHANGED) {
+            ret = buffer_read_tile(band, buffer, tile, cache);
             if (ret == 1)
                 return 1;
+            if (mode == BLOCK_SPLIT)
+                band->gap = 0;
+        }
+
+        band->origin = 0;
 
-            if (ret == 0 || tycho->redraw) {
-                image_info_t tile_image = {
-                    .data = &image->data[(j * image->stride + i) * TILE_SIZE],
-                    .w = _1_(i != w / TILE_SIZE) ? TILE_SIZE : w % TILE_SIZE,
-                    .h = _1_(j != h / TILE_SIZE) ? TILE_SIZE : h % TILE_SIZE,
-                    .stride = image->stride,
-                };
-                draw_tile(&tycho->tiles.tile[tycho->tile], &tile_image);
+        if (ret == 0 || ret == 2 || tycho->redraw) {
+            image_info_t tile_image = {
+                .data = &image->data[(j * image->stride + i) * TILE_SIZE],
+                .w = _1_(i != w / TILE_SIZE) ? TILE_SIZE : w % TILE_SIZE,
+                .h = _1_(j != h / TILE_SIZE) ? TILE_SIZE : h % TILE_SIZE,
+                .stride = image->stride,
+            };
+            if (ret == 2)
+                move_tile(tycho, &tile_image, i * TILE_SIZE, j * TILE_SIZE);
+            else
+                draw_tile(tile, &tile_image);
+        }
+    }
+
+    return 0;
+}
+
+static void
+band_decode(void *data, unsigned k)
+{
+    tycho_t *const tycho = data;
+    tycho_band_t *const band = &tycho->band[k];
+
+    if (band_recv(band, tycho, &band->buffer, tycho->image))
+        warning("band %u is truncated\n", k);
+}
+
+static int
+frame_recv(tycho_t *tycho, buffer_t *buffer)
+{
+    if (!tycho->part) {
+        if (buffer_read_size(buffer) < 13 + 4 * tycho->bands)
+            return 1;
+
+        tycho->cache.use = buffer_read(buffer);
+
+        tycho->move.x = buffer_read_16(buffer);
+        tycho->move.y = buffer_read_16(buffer);
+        tycho->move.w = buffer_read_16(buffer);
+        tycho->move.h = buffer_read_16(buffer);
+        tycho->move.dx = (int16_t)buffer_read_16(buffer);
+        tycho->move.dy = (int16_t)buffer_read_16(buffer);
+
+        for (unsigned k = 0; k < tycho->bands; k++) {
+            buffer_t *const band_buffer = &tycho->band[k].buffer;
+            const size_t size = buffer_read_32(buffer);
+
+            if (buffer_size(band_buffer) < size) {
+                safe_free(band_buffer->data);
+                buffer_setup(band_buffer, NULL, size);
             }
 
-            tycho->tile++;
+            buffer_format(band_buffer);
+            band_buffer->end = band_buffer->data + size;
         }
+
+        tycho->part = 1;
+    }
+
+    for (; tycho->part <= tycho->bands; tycho->part++) {
+        buffer_t *const band_buffer = &tycho->band[tycho->part - 1].buffer;
+
+        buffer_copy(band_buffer, buffer);
+
+        if (buffer_write_size(band_buffer))
+            return 1;
     }
 
     return 0;
 }
+
+void
+tycho_draw_tile(tycho_tile_t *tile, image_info_t *image)
+{
+    draw_tile(tile, image);
+}
+
+int
+tycho_recv(tycho_t *tycho, buffer_t *buffer, image_info_t *image)
+{
+    if (frame_recv(tycho, buffer))
+        return 1;
+
+    tycho->image = image;
+
+    move_setup(tycho, image);
+
+    worker_run(band_decode, tycho, tycho->bands);
+
+    return 0;
+}
+
+int
+tycho_recv_start(tycho_t *tycho, buffer_t *buffer, image_info_t *image)
+{
+    if (frame_recv(tycho, buffer))
+        return 1;
+
+    tycho->image = image;
+
+    move_setup(tycho, image);
+
+    global.decode = tycho;
+    worker_start(band_decode, tycho, tycho->bands);
+
+    return 0;
+}
+
+int
+tycho_recv_skip(tycho_t *tycho, buffer_t *buffer)
+{
+    return frame_recv(tycho, buffer);
+}
+
+int
+tycho_recv_busy(tycho_t *tycho)
+{
+    if (tycho && tycho != global.decode)
+        return 0;
+
+    return worker_busy();
+}
+
+void
+tycho_recv_wait(tycho_t *tycho)
+{
+    if (tycho && tycho != global.decode)
+        return;
+
+    worker_wait();
+}
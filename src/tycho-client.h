@@ -2,4 +2,9 @@
 
 #include "tycho.h"
 
-int tycho_recv (tycho_t *, buffer_t *, image_info_t *);
+void tycho_draw_tile  (tycho_tile_t *, image_info_t *);
+int  tycho_recv       (tycho_t *, buffer_t *, image_info_t *);
+int  tycho_recv_start (tycho_t *, buffer_t *, image_info_t *);
+int  tycho_recv_skip  (tycho_t *, buffer_t *);
+int  tycho_recv_busy  (tycho_t *);
+void tycho_recv_wait  (tycho_t *);
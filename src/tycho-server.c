@@ -1,72 +1,224 @@
 #include "tycho-server.h"
 #include "tycho-static.h"
 #include "color-static.h"
+#include "worker.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TYCHO_X86
+#endif
 
 typedef struct cmap cmap_t;
+typedef struct rect rect_t;
+typedef struct line line_t;
 
 struct cmap {
     uint32_t h, r, g, b;
 };
 
+struct rect {
+    int x, y, w, h;
+};
+
+struct line {
+    uint32_t hash;
+    int index;
+};
+
+typedef void (*row_diff_t) (uint8_t *, const image_info_t *, const image_info_t *, unsigned);
+
 static struct tycho_server_global {
     tycho_tiles_t tiles;
+    uint32_t *gen;
+    uint32_t *base;
+    uint32_t *row;
+    unsigned serial;
+    unsigned bands;
+    unsigned coder;
+    unsigned block;
+    unsigned run;
+    size_t cache;
+    struct {
+        image_info_t image;
+        uint8_t *changed;
+        row_diff_t diff;
+    } prev;
+    struct {
+        int use;
+        rect_t *rect;
+        unsigned count;
+        unsigned size;
+        uint8_t *map;
+    } damage;
+    struct {
+        unsigned serial;
+        rect_t rect;
+        int dx, dy;
+        uint8_t *map;
+        uint32_t *hash;
+        unsigned *vote;
+        line_t *line;
+        unsigned size;
+    } move;
+    unsigned refine;
     struct {
         unsigned min;
         unsigned max;
     } quality;
+    struct {
+        int use;
+        tycho_t tycho;
+        tycho_frame_t *frame;
+        unsigned base;
+        unsigned reset;
+    } shared;
 } global;
 
+static void
+tile_yuv(uint32_t *const restrict yuv,
+         const uint32_t *const restrict data)
+{
+    unsigned i = 0;
+
+#ifdef __SSE2__
+    const __m128i m = _mm_set1_epi32(0xFF);
+
+    for (; i < TILE_SIZE * TILE_SIZE; i += 4) {
+        const __m128i c = _mm_loadu_si128((const __m128i *)&data[i]);
+        const __m128i r = _mm_and_si128(_mm_srli_epi32(c, COLOR_R_SHIFT), m);
+        const __m128i g = _mm_and_si128(_mm_srli_epi32(c, COLOR_G_SHIFT), m);
+        const __m128i b = _mm_and_si128(_mm_srli_epi32(c, COLOR_B_SHIFT), m);
+        const __m128i y = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(r, b),
+                                                       _mm_slli_epi32(g, 1)), 2);
+        const __m128i x = _mm_sub_epi32(m, y);
+        const __m128i u = _mm_srli_epi32(_mm_add_epi32(b, x), 1);
+        const __m128i v = _mm_srli_epi32(_mm_add_epi32(r, x), 1);
+        const __m128i o = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(y, COLOR_R_SHIFT),
+                                                    _mm_slli_epi32(u, COLOR_G_SHIFT)),
+                                       _mm_or_si128(_mm_slli_epi32(v, COLOR_B_SHIFT),
+                                                    _mm_set1_epi32(COLOR_A << COLOR_A_SHIFT)));
+        _mm_storeu_si128((__m128i *)&yuv[i], o);
+    }
+#endif
+
+    for (; i < TILE_SIZE * TILE_SIZE; i++) {
+        const uint32_t c = data[i];
+        const uint32_t r = color_get_r(c);
+        const uint32_t g = color_get_g(c);
+        const uint32_t b = color_get_b(c);
+        const uint32_t y = (r + (g << 1) + b) >> 2;
+        const uint32_t u = (b + (255 - y)) >> 1;
+        const uint32_t v = (r + (255 - y)) >> 1;
+        yuv[i] = color_rgb(y, u, v);
+    }
+}
+
+_pure_ static unsigned
+cmap_find(const uint32_t *const restrict key,
+          const unsigned count,
+          const uint32_t h)
+{
+#ifdef __SSE2__
+    (void)count;
+
+    const __m128i x = _mm_set1_epi32(h);
+
+    const int m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, _mm_loadu_si128((const __m128i *)&key[0]))))
+           | (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, _mm_loadu_si128((const __m128i *)&key[4])))) << 4)
+           | (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, _mm_loadu_si128((const __m128i *)&key[8])))) << 8);
+
+    return m ? CTZ(m) : COLOR_MAX;
+#else
+    for (unsigned k = 0; k < count; k++) {
+        if (key[k] == h)
+            return k;
+    }
+
+    return COLOR_MAX;
+#endif
+}
+
 static unsigned
 build_cmap(cmap_t *const restrict cmap,
            const uint32_t *const restrict data,
            uint8_t *const restrict index,
-           const unsigned depth)
+           unsigned *const restrict depth,
+           const unsigned depth_min)
 {
-    for (unsigned k = 0; k < COLOR_MAX; k++)
-        cmap[k] = (cmap_t){0, 0, 0, 0};
+    uint32_t yuv[TILE_SIZE * TILE_SIZE];
 
-    const uint32_t p = (0xFF >> (8 - depth)) << (8 - depth);
-    const uint32_t mask = p | (p << 8) | (p << 16);
+    tile_yuv(yuv, data);
 
-    unsigned count = 0;
+    uint32_t key[9][COLOR_MAX];
+    uint32_t mask[9];
+    unsigned count[9];
 
-    for (unsigned j = 0; j < TILE_SIZE; j++) {
-        for (unsigned i = 0; i < TILE_SIZE; i++) {
-            uint32_t c = data[j * TILE_SIZE + i];
-            const uint32_t r = color_get_r(c);
-            const uint32_t g = color_get_g(c);
-            const uint32_t b = color_get_b(c);
-            const uint32_t y = (r + (g << 1) + b) >> 2;
-            const uint32_t u = (b + (255 - y)) >> 1;
-            const uint32_t v = (r + (255 - y)) >> 1;
-            c = color_rgb(y, u, v);
-            const uint32_t h = c & mask;
-            unsigned k = 0;
-            for (; k < count; k++) {
-                if (((cmap[k].h & mask) == h))
-                    break;
-            }
-            if _0_(k == count) {
-                if _0_(k == COLOR_MAX)
-                    return 0;
-                cmap[k].h = c & 0xFFFFFF;
-                count++;
+    int hi = *depth;
+    int lo = MIN(depth_min, *depth);
+
+    for (int d = lo; d <= hi; d++) {
+        const uint32_t p = (0xFF >> (8 - d)) << (8 - d);
+        mask[d] = p | (p << 8) | (p << 16);
+        count[d] = 0;
+        for (unsigned k = 0; k < COLOR_MAX; k++)
+            key[d][k] = ~0;
+    }
+
+    for (unsigned i = 0; i < TILE_SIZE * TILE_SIZE; i++) {
+        for (int d = hi; d >= lo; d--) {
+            const uint32_t h = yuv[i] & mask[d];
+            if (cmap_find(key[d], count[d], h) < COLOR_MAX)
+                break;
+            if _0_(count[d] == COLOR_MAX) {
+                hi = d - 1;
+                continue;
             }
-            cmap[k].h += 1 << 24;
-            cmap[k].r += y;
-            cmap[k].g += u;
-            cmap[k].b += v;
-            index[j * TILE_SIZE + i] = k;
+            key[d][count[d]++] = h;
         }
+        if _0_(hi < lo)
+            return 0;
     }
 
-    return count;
+    for (unsigned k = 0; k < COLOR_MAX; k++)
+        cmap[k] = (cmap_t){0, 0, 0, 0};
+
+    for (unsigned i = 0; i < TILE_SIZE * TILE_SIZE; i++) {
+        const uint32_t c = yuv[i];
+        const unsigned k = cmap_find(key[hi], count[hi], c & mask[hi]);
+        cmap[k].h += 1 << 24;
+        cmap[k].r += color_get_r(c);
+        cmap[k].g += color_get_g(c);
+        cmap[k].b += color_get_b(c);
+        index[i] = k;
+    }
+
+    *depth = hi;
+
+    return count[hi];
 }
 
 static int
 tile_write(tycho_tile_t *const restrict tile,
-           const image_info_t *const restrict image)
+           const image_info_t *const restrict image,
+           const image_info_t *const restrict prev,
+           const int changed,
+           const unsigned start)
 {
+    unsigned count, depth;
+
+    if (!changed) {
+        if (tile->depth_stop)
+            return 0;
+        if (tile->depth_step < tile->depth - global.quality.min + 1) {
+            tile->depth_step++;
+            return 0;
+        }
+        depth = tile->depth + 1;
+    } else {
+        tile->depth_stop = 0;
+        depth = start;
+    }
+
     uint32_t hash = 0;
     uint32_t tile_data[TILE_SIZE * TILE_SIZE];
 
@@ -81,46 +233,45 @@ tile_write(tycho_tile_t *const restrict tile,
         }
     }
 
-    hash |= 1;
-
-    unsigned count, depth;
-
-    if (tile->hash == hash) {
-        if (tile->depth_stop)
-            return 0;
-        if (tile->depth_step < tile->depth - global.quality.min + 1) {
-            tile->depth_step++;
-            return 0;
-        }
-        depth = tile->depth + 1;
-    } else {
-        tile->depth_stop = 0;
-        depth = global.quality.min;
+    if (changed) {
+        for (unsigned j = 0; j < h; j++)
+            byte_copy(&prev->data[j * prev->stride],
+                      &image->data[j * image->stride], w * 4);
     }
 
+    hash |= 1;
+
     cmap_t cmap[COLOR_MAX];
     uint8_t index[TILE_SIZE * TILE_SIZE];
 
-    for (;;) {
-        count = build_cmap(cmap, tile_data, index, depth);
-        if (count)
-            break;
+    const unsigned want = depth;
+
+    count = build_cmap(cmap, tile_data, index, &depth, changed ? 1 : depth);
+
+    if (depth < want || !count)
         tile->depth_stop = 1;
-        if (hash == tile->hash)
-            return 0;
-        depth--;
-    }
+
+    if (!count)
+        return 0;
+
+    int diff = tile->count != count;
 
     for (unsigned k = 0; k < count; k++) {
         const uint32_t n = cmap[k].h >> 24;
-        tile->color[k * 3 + 0] = cmap[k].r / n;
-        tile->color[k * 3 + 1] = cmap[k].g / n;
-        tile->color[k * 3 + 2] = cmap[k].b / n;
+        const uint8_t r = cmap[k].r / n;
+        const uint8_t g = cmap[k].g / n;
+        const uint8_t b = cmap[k].b / n;
+        diff |= (tile->color[k * 3 + 0] ^ r) | (tile->color[k * 3 + 1] ^ g) | (tile->color[k * 3 + 2] ^ b);
+        tile->color[k * 3 + 0] = r;
+        tile->color[k * 3 + 1] = g;
+        tile->color[k * 3 + 2] = b;
     }
 
     if (count > 1) {
-        for (unsigned i = 0; i < TILE_SIZE * TILE_SIZE; i++)
+        for (unsigned i = 0; i < TILE_SIZE * TILE_SIZE; i++) {
+            diff |= tile->index[i] ^ index[i];
             tile->index[i] = index[i];
+        }
     }
 
     if (depth == global.quality.max)
@@ -131,9 +282,369 @@ tile_write(tycho_tile_t *const restrict tile,
     tile->hash = hash;
     tile->count = count;
 
+    return diff ? 2 : 1;
+}
+
+_pure_ static int
+tile_diff(const uint32_t *a, int stride_a,
+          const uint32_t *b, int stride_b,
+          unsigned w, unsigned h)
+{
+    for (unsigned j = 0; j < h; j++) {
+        for (unsigned i = 0; i < w; i++)
+            if (a[j * stride_a + i] != b[j * stride_b + i])
+                return 1;
+    }
+
+    return 0;
+}
+
+static void
+row_diff_c(uint8_t *const restrict changed,
+           const image_info_t *const restrict image,
+           const image_info_t *const restrict prev,
+           const unsigned h)
+{
+    const unsigned n = image->w / TILE_SIZE;
+
+    for (unsigned i = 0; i < n; i++) {
+        const uint32_t *a = &image->data[i * TILE_SIZE];
+        const uint32_t *b = &prev->data[i * TILE_SIZE];
+        uint32_t acc = 0;
+        for (unsigned j = 0; j < h && !acc; j++) {
+            for (unsigned k = 0; k < TILE_SIZE; k++)
+                acc |= a[j * image->stride + k] ^ b[j * prev->stride + k];
+        }
+        changed[i] = !!acc;
+    }
+}
+
+#ifdef TYCHO_X86
+__attribute__((target("sse2"))) static void
+row_diff_sse2(uint8_t *const restrict changed,
+              const image_info_t *const restrict image,
+              const image_info_t *const restrict prev,
+              const unsigned h)
+{
+    const unsigned n = image->w / TILE_SIZE;
+    const __m128i zero = _mm_setzero_si128();
+
+    for (unsigned i = 0; i < n; i++) {
+        const uint32_t *a = &image->data[i * TILE_SIZE];
+        const uint32_t *b = &prev->data[i * TILE_SIZE];
+        int diff = 0;
+        for (unsigned j = 0; j < h && !diff; j++) {
+            const __m128i *ra = (const __m128i *)&a[j * image->stride];
+            const __m128i *rb = (const __m128i *)&b[j * prev->stride];
+            const __m128i x = _mm_or_si128(
+                _mm_xor_si128(_mm_loadu_si128(ra), _mm_loadu_si128(rb)),
+                _mm_xor_si128(_mm_loadu_si128(ra + 1), _mm_loadu_si128(rb + 1)));
+            diff = _mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)) != 0xFFFF;
+        }
+        changed[i] = diff;
+    }
+}
+
+__attribute__((target("avx2"))) static void
+row_diff_avx2(uint8_t *const restrict changed,
+              const image_info_t *const restrict image,
+              const image_info_t *const restrict prev,
+              const unsigned h)
+{
+    const unsigned n = image->w / TILE_SIZE;
+
+    for (unsigned i = 0; i < n; i++) {
+        const uint32_t *a = &image->data[i * TILE_SIZE];
+        const uint32_t *b = &prev->data[i * TILE_SIZE];
+        int diff = 0;
+        for (unsigned j = 0; j < h && !diff; j++) {
+            const __m256i x = _mm256_xor_si256(
+                _mm256_loadu_si256((const __m256i *)&a[j * image->stride]),
+                _mm256_loadu_si256((const __m256i *)&b[j * prev->stride]));
+            diff = !_mm256_testz_si256(x, x);
+        }
+        changed[i] = diff;
+    }
+}
+#endif
+
+static row_diff_t
+row_diff_select(void)
+{
+#ifdef TYCHO_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return row_diff_avx2;
+
+    if (__builtin_cpu_supports("sse2"))
+        return row_diff_sse2;
+#endif
+    return row_diff_c;
+}
+
+static int
+prev_resize(unsigned w, unsigned h)
+{
+    image_info_t *const prev = &global.prev.image;
+
+    if (!global.prev.diff)
+        global.prev.diff = row_diff_select();
+
+    if (prev->data && prev->w == (int)w && prev->h == (int)h)
+        return 0;
+
+    safe_free(prev->data);
+    safe_free(global.prev.changed);
+
+    prev->data = safe_calloc(w * h, 4);
+    prev->stride = w;
+    prev->w = w;
+    prev->h = h;
+
+    safe_free(global.damage.map);
+    safe_free(global.move.map);
+    safe_free(global.move.hash);
+    safe_free(global.move.vote);
+    safe_free(global.move.line);
+
+    safe_free(global.gen);
+    safe_free(global.base);
+    safe_free(global.row);
+
+    global.gen = safe_calloc(DIV(w, TILE_SIZE) * DIV(h, TILE_SIZE), sizeof(uint32_t));
+    global.base = safe_calloc(DIV(w, TILE_SIZE) * DIV(h, TILE_SIZE), sizeof(uint32_t));
+    global.row = safe_calloc(DIV(h, TILE_SIZE), sizeof(uint32_t));
+
+    global.prev.changed = safe_calloc(DIV(w, TILE_SIZE), 1);
+    global.damage.map = safe_calloc(DIV(w, TILE_SIZE) * DIV(h, TILE_SIZE), 1);
+
+    const unsigned n = MAX(w, h);
+
+    global.move.size = 1u << (32 - CLZ(n) + 1);
+    global.move.map = safe_calloc(DIV(w, TILE_SIZE) * DIV(h, TILE_SIZE), 1);
+    global.move.hash = safe_calloc(2 * n, sizeof(uint32_t));
+    global.move.vote = safe_calloc(2 * n, sizeof(unsigned));
+    global.move.line = safe_calloc(global.move.size, sizeof(line_t));
+
     return 1;
 }
 
+void
+tycho_set_damage(int x, int y, int w, int h)
+{
+    global.damage.use = 1;
+
+    if (w <= 0 || h <= 0)
+        return;
+
+    if (global.damage.count == global.damage.size) {
+        global.damage.size = global.damage.size * 2 + 16;
+        global.damage.rect = safe_realloc(global.damage.rect,
+                                          global.damage.size * sizeof(rect_t));
+    }
+
+    global.damage.rect[global.damage.count++] = (rect_t) {
+        .x = x, .y = y, .w = w, .h = h,
+    };
+}
+
+int
+tycho_pending(void)
+{
+    return !global.damage.use || global.damage.count || global.refine;
+}
+
+static void
+damage_map(int all)
+{
+    const unsigned wn = global.tiles.wn;
+    const unsigned hn = global.tiles.hn;
+
+    uint8_t *const map = global.damage.map;
+
+    if (all || !global.damage.use) {
+        byte_set(map, 1, wn * hn);
+        global.damage.count = 0;
+        return;
+    }
+
+    byte_set(map, 0, wn * hn);
+
+    for (unsigned k = 0; k < global.damage.count; k++) {
+        const rect_t *r = &global.damage.rect[k];
+
+        const int x0 = MAX(r->x, 0) / TILE_SIZE;
+        const int y0 = MAX(r->y, 0) / TILE_SIZE;
+        const int x1 = MIN(DIV(r->x + r->w, TILE_SIZE), (int)wn);
+        const int y1 = MIN(DIV(r->y + r->h, TILE_SIZE), (int)hn);
+
+        for (int j = y0; j < y1; j++)
+            for (int i = x0; i < x1; i++)
+                map[j * wn + i] = 1;
+    }
+
+    global.damage.count = 0;
+}
+
+static uint32_t
+line_hash(const uint32_t *data, unsigned n)
+{
+    uint32_t hash = 0;
+
+    for (unsigned i = 0; i < n; i++)
+        hash = (hash << 5) - hash + data[i];
+
+    return hash | 1;
+}
+
+static int
+move_find(const uint32_t *cur, const uint32_t *prev, unsigned n)
+{
+    const unsigned mask = global.move.size - 1;
+    line_t *const line = global.move.line;
+    unsigned *const vote = global.move.vote;
+
+    byte_set(line, 0, global.move.size * sizeof(line_t));
+    byte_set(vote, 0, 2 * n * sizeof(unsigned));
+
+    for (unsigned i = 0; i < n; i++) {
+        unsigned k = prev[i] & mask;
+
+        while (line[k].hash && line[k].hash != prev[i])
+            k = (k + 1) & mask;
+
+        line[k].index = line[k].hash ? -1 : (int)i;
+        line[k].hash = prev[i];
+    }
+
+    for (unsigned i = 0; i < n; i++) {
+        unsigned k = cur[i] & mask;
+
+        while (line[k].hash && line[k].hash != cur[i])
+            k = (k + 1) & mask;
+
+        if (line[k].hash && line[k].index >= 0 && line[k].index != (int)i)
+            vote[n + line[k].index - i]++;
+    }
+
+    unsigned best = 0;
+
+    for (unsigned d = 1; d < 2 * n; d++)
+        if (vote[d] > vote[best])
+            best = d;
+
+    if (vote[best] < MAX(CONFIG_MOVE_LINES, n / 16))
+        return 0;
+
+    return (int)best - (int)n;
+}
+
+static unsigned
+move_depth(int x, int y, unsigned w, unsigned h)
+{
+    const unsigned wn = global.tiles.wn;
+    unsigned depth = ~0u;
+
+    for (int j = y / TILE_SIZE; j <= (int)(y + h - 1) / TILE_SIZE; j++)
+        for (int i = x / TILE_SIZE; i <= (int)(x + w - 1) / TILE_SIZE; i++)
+            depth = MIN(depth, global.tiles.tile[j * wn + i].depth);
+
+    return depth;
+}
+
+static void
+move_detect(const image_info_t *image, rect_t area)
+{
+    const image_info_t *const prev = &global.prev.image;
+    uint32_t *const cur_hash = global.move.hash;
+    uint32_t *const prev_hash = &global.move.hash[MAX(image->w, image->h)];
+
+    int dx = 0;
+    int dy = 0;
+
+    for (int y = 0; y < area.h; y++) {
+        cur_hash[y] = line_hash(&image->data[(area.y + y) * image->stride + area.x], area.w);
+        prev_hash[y] = line_hash(&prev->data[(area.y + y) * prev->stride + area.x], area.w);
+    }
+
+    dy = move_find(cur_hash, prev_hash, area.h);
+
+    if (!dy) {
+        byte_set(cur_hash, 0, area.w * sizeof(uint32_t));
+        byte_set(prev_hash, 0, area.w * sizeof(uint32_t));
+
+        for (int y = 0; y < area.h; y++) {
+            const uint32_t *const a = &image->data[(area.y + y) * image->stride + area.x];
+            const uint32_t *const b = &prev->data[(area.y + y) * prev->stride + area.x];
+
+            for (int x = 0; x < area.w; x++) {
+                cur_hash[x] = (cur_hash[x] << 5) - cur_hash[x] + a[x];
+                prev_hash[x] = (prev_hash[x] << 5) - prev_hash[x] + b[x];
+            }
+        }
+
+        for (int x = 0; x < area.w; x++) {
+            cur_hash[x] |= 1;
+            prev_hash[x] |= 1;
+        }
+
+        dx = move_find(cur_hash, prev_hash, area.w);
+    }
+
+    if (!dx && !dy)
+        return;
+
+    const unsigned wn = global.tiles.wn;
+    const unsigned hn = global.tiles.hn;
+
+    int x0 = image->w, y0 = image->h, x1 = 0, y1 = 0;
+
+    byte_set(global.move.map, 0, wn * hn);
+
+    for (unsigned j = area.y / TILE_SIZE; j < hn && j * TILE_SIZE < (unsigned)(area.y + area.h); j++) {
+        for (unsigned i = area.x / TILE_SIZE; i < wn && i * TILE_SIZE < (unsigned)(area.x + area.w); i++) {
+            if (!global.damage.map[j * wn + i])
+                continue;
+
+            const int x = i * TILE_SIZE;
+            const int y = j * TILE_SIZE;
+            const unsigned tw = MIN(TILE_SIZE, image->w - x);
+            const unsigned th = MIN(TILE_SIZE, image->h - y);
+
+            if (x + dx < 0 || y + dy < 0 ||
+                x + dx + (int)tw > image->w || y + dy + (int)th > image->h)
+                continue;
+
+            if (tile_diff(&image->data[y * image->stride + x], image->stride,
+                          &prev->data[(y + dy) * prev->stride + x + dx], prev->stride, tw, th))
+                continue;
+
+            const unsigned depth = move_depth(x + dx, y + dy, tw, th);
+
+            if (!depth)
+                continue;
+
+            global.move.map[j * wn + i] = depth;
+
+            x0 = MIN(x0, x);
+            y0 = MIN(y0, y);
+            x1 = MAX(x1, x + (int)tw);
+            y1 = MAX(y1, y + (int)th);
+        }
+    }
+
+    if (x0 >= x1)
+        return;
+
+    global.move.serial = global.serial;
+    global.move.rect = (rect_t) {
+        .x = x0, .y = y0, .w = x1 - x0, .h = y1 - y0,
+    };
+    global.move.dx = dx;
+    global.move.dy = dy;
+}
+
 int
 tycho_set_image(image_info_t *image)
 {
@@ -142,25 +653,136 @@ tycho_set_image(image_info_t *image)
 
     tycho_tiles_resize(&global.tiles, w, h);
 
+    const int all = prev_resize(w, h);
+
+    damage_map(all);
+
     const unsigned wn = global.tiles.wn;
     const unsigned hn = global.tiles.hn;
 
+    uint8_t *const changed = global.prev.changed;
+    const image_info_t *const prev = &global.prev.image;
+
+    unsigned i0 = wn, j0 = hn, i1 = 0, j1 = 0;
+    unsigned count = 0;
+
+    for (unsigned j = 0; j < hn && !all; j++) {
+        const unsigned th = _1_(j != h / TILE_SIZE) ? TILE_SIZE : h % TILE_SIZE;
+        uint8_t *const map = &global.damage.map[j * wn];
+
+        unsigned lo = 0, hi = wn;
+
+        while (lo < hi && !map[lo])
+            lo++;
+
+        while (hi > lo && !map[hi - 1])
+            hi--;
+
+        if (lo == hi)
+            continue;
+
+        byte_set(changed, 0, wn);
+
+        const unsigned n = MIN(hi, w / TILE_SIZE);
+
+        if (lo < n) {
+            const image_info_t row_image = {
+                .data = &image->data[j * image->stride * TILE_SIZE + lo * TILE_SIZE],
+                .w = (n - lo) * TILE_SIZE,
+                .stride = image->stride,
+            };
+            const image_info_t row_prev = {
+                .data = &prev->data[j * prev->stride * TILE_SIZE + lo * TILE_SIZE],
+                .w = (n - lo) * TILE_SIZE,
+                .stride = prev->stride,
+            };
+            global.prev.diff(&changed[lo], &row_image, &row_prev, th);
+        }
+
+        if (n < hi) {
+            const unsigned x = n * TILE_SIZE;
+            changed[n] = tile_diff(&image->data[j * image->stride * TILE_SIZE + x], image->stride,
+                                   &prev->data[j * prev->stride * TILE_SIZE + x], prev->stride,
+                                   w % TILE_SIZE, th);
+        }
+
+        for (unsigned i = lo; i < hi; i++) {
+            map[i] &= changed[i];
+
+            if (!map[i])
+                continue;
+
+            i0 = MIN(i0, i);
+            i1 = MAX(i1, i + 1);
+            j0 = MIN(j0, j);
+            j1 = j + 1;
+            count++;
+        }
+    }
+
+    global.move.rect.w = 0;
+
+    if (count >= CONFIG_MOVE_TILES) {
+        const rect_t area = {
+            .x = i0 * TILE_SIZE,
+            .y = j0 * TILE_SIZE,
+            .w = MIN(i1 * TILE_SIZE, w) - i0 * TILE_SIZE,
+            .h = MIN(j1 * TILE_SIZE, h) - j0 * TILE_SIZE,
+        };
+        move_detect(image, area);
+    }
+
     unsigned tile = 0;
+    unsigned refine = 0;
     int ret = 0;
 
     for (unsigned j = 0; j < hn; j++) {
-        for (unsigned i = 0; i < wn; i++) {
+        const unsigned th = _1_(j != h / TILE_SIZE) ? TILE_SIZE : h % TILE_SIZE;
+
+        for (unsigned i = 0; i < wn; i++, tile++) {
+            tycho_tile_t *const t = &global.tiles.tile[tile];
+            const uint8_t change = global.damage.map[tile];
+
+            if (!change && t->depth_stop)
+                continue;
+
+            unsigned start = global.quality.min;
+
+            if (change && global.move.rect.w && global.move.map[tile])
+                start = CLAMP(global.move.map[tile], global.quality.min, global.quality.max);
+
             image_info_t tile_image = {
                 .data = &image->data[(j * image->stride + i) * TILE_SIZE],
                 .w = _1_(i != w / TILE_SIZE) ? TILE_SIZE : w % TILE_SIZE,
-                .h = _1_(j != h / TILE_SIZE) ? TILE_SIZE : h % TILE_SIZE,
+                .h = th,
                 .stride = image->stride,
             };
-            ret += tile_write(&global.tiles.tile[tile], &tile_image);
-            tile++;
+            image_info_t tile_prev = {
+                .data = &prev->data[(j * prev->stride + i) * TILE_SIZE],
+                .stride = prev->stride,
+            };
+            const int write = tile_write(t, &tile_image, &tile_prev, change, start);
+
+            if (write == 2) {
+                global.gen[tile] = global.serial + 1;
+                global.row[j] = global.serial + 1;
+            }
+
+            if (change)
+                global.base[tile] = global.serial + 1;
+
+            ret += !!write;
+
+            if (!t->depth_stop)
+                refine++;
         }
     }
 
+    global.refine = refine;
+
+    if (ret)
+        global.serial++;
+
     return ret;
 }
 
@@ -198,38 +820,75 @@ tile_are_equal(const tycho_tile_t *const restrict ta,
     return 1;
 }
 
+_pure_ static uint32_t
+cache_key(const tycho_tile_t *const restrict tile)
+{
+    return tile->hash ^ ((uint32_t)tile->depth << 24);
+}
+
+static int
+cache_find(const tycho_cache_t *const restrict cache,
+           const tycho_tile_t *const restrict tile)
+{
+    const uint32_t key = cache_key(tile);
+    const uint32_t slot = cache->table[cache_index(cache, key)];
+
+    if (!slot || cache->key[slot - 1] != key ||
+            !tile_are_equal(tile, &cache->tile[slot - 1]))
+        return -1;
+
+    return slot - 1;
+}
+
 static int
-buffer_write_tile(tycho_t *const restrict tycho,
+buffer_write_tile(tycho_band_t *const restrict band,
                   buffer_t *const restrict buffer,
                   tycho_tile_t *const restrict tile,
-                  tycho_tile_t *const restrict tile_old)
+                  const int same,
+                  const int copy)
 {
-    tycho_state_t st = tycho->state;
+    tycho_cache_t *const cache = band->cache.size ? &band->cache : NULL;
+    tycho_state_t st = band->state;
 
     if (!st.count) {
         uint8_t count = tile->count;
-        if (tile_are_equal(tile, tile_old))
+        if (same)
             count = 0;
-        if (encode(&tycho->coder, buffer, &tycho->count.model, count, 4, tycho->count.ctx))
+        else if (copy)
+            count = TILE_COPY;
+        else if (cache && cache_find(cache, tile) >= 0)
+            count = TILE_CACHE;
+        if (encode(&band->coder, buffer, &band->count.model, count, 4, band->count.ctx))
             goto save_state;
-        tycho->count.ctx = ((tycho->count.ctx << 4) | count) & 0xFFF;
-        if (!count)
+        band->count.ctx = ((band->count.ctx << 4) | count) & 0xFFF;
+        if (!count || count == TILE_COPY)
             return -1;
         byte_set(&st, 0, sizeof(st));
         st.i = 1;
         st.count = count;
     }
 
+    if (st.count == TILE_CACHE) {
+        const unsigned slot = cache_find(cache, tile);
+        for (; st.k < 2; st.k++) {
+            if (encode(&band->coder, buffer, &band->slot.model, st.k ? slot & 0xFF : slot >> 8, 8, 0))
+                goto save_state;
+        }
+        cache_use(cache, slot);
+        cache->hit++;
+        band->state.count = 0;
+        return 0;
+    }
+
     for (; st.k < st.count * 3; st.k++) {
         uint8_t c = tile->color[st.k];
-        if (encode(&tycho->coder, buffer, &tycho->color[st.k % 3].model, c, 8, tycho->color[st.k % 3].ctx))
+        if (encode(&band->coder, buffer, &band->color[st.k % 3].model, c, 8, band->color[st.k % 3].ctx))
             goto save_state;
-        tycho->color[st.k % 3].ctx = c;
+        band->color[st.k % 3].ctx = c;
     }
 
     if _1_(st.count > 1) {
-        static const int lg[] = {1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4};
-        tycho_model_t *const restrict model = tycho->index.model;
+        tycho_model_t *const restrict model = band->index.model;
         for (; st.j < TILE_SIZE; st.j++) {
             for (; st.i < TILE_SIZE; st.i++) {
                 const uint8_t p = tile->index[st.j * TILE_SIZE + st.i];
@@ -240,7 +899,7 @@ buffer_write_tile(tycho_t *const restrict tycho,
                     ctx |= tile->index[st.j * TILE_SIZE + st.i - TILE_SIZE] << 4;
                 if (st.i && st.j)
                     ctx |= tile->index[st.j * TILE_SIZE + st.i - TILE_SIZE - 1] << 8;
-                if (encode(&tycho->coder, buffer, &model[st.pmax], p, lg[st.pmax], ctx))
+                if (encode(&band->coder, buffer, &model[st.pmax], p, model[st.pmax].bits, ctx))
                     goto save_state;
                 if (st.pmax < p)
                     st.pmax = p;
@@ -249,44 +908,530 @@ buffer_write_tile(tycho_t *const restrict tycho,
         }
     }
 
-    tycho->state.count = 0;
+    if (cache) {
+        cache_add(cache, tile, cache_key(tile));
+        cache->miss++;
+    }
+
+    band->state.count = 0;
     return 0;
 
 save_state:
-    tycho->state = st;
+    band->state = st;
     return 1;
 }
 
-void
-tycho_setup_server(tycho_t *tycho)
+_pure_ static int
+tile_same(const tycho_t *const restrict tycho, unsigned k)
 {
-    tycho_setup(tycho, global.tiles.w, global.tiles.h);
+    const uint32_t gen = tycho->gen[k];
 
-    tycho_tiles_t tmp = tycho->tiles;
-    tycho->tiles = tycho->tiles_old;
-    tycho->tiles_old = tmp;
+    if (gen == global.gen[k])
+        return 1;
 
-    tycho_tiles_copy(&tycho->tiles, &global.tiles);
+    return tycho->quality.limit && gen >= global.base[k] &&
+           global.tiles.tile[k].depth > tycho->quality.limit;
 }
 
-int
-tycho_send(tycho_t *tycho, buffer_t *buffer)
+static uint8_t
+block_get(tycho_t *const restrict tycho, unsigned j0, unsigned i0)
+{
+    const unsigned wn = tycho->tiles.wn;
+    const unsigned j1 = MIN(j0 + (1u << tycho->block.size), tycho->tiles.hn);
+    const unsigned i1 = MIN(i0 + (1u << tycho->block.size), wn);
+
+    const tycho_tile_t *const first = &global.tiles.tile[j0 * wn + i0];
+
+    int unchanged = !tycho->redraw;
+    int uniform = 1;
+
+    for (unsigned j = j0; j < j1; j++) {
+        for (unsigned i = i0; i < i1; i++) {
+            const tycho_tile_t *const tile = &global.tiles.tile[j * wn + i];
+
+            if (unchanged && !tile_same(tycho, j * wn + i))
+                unchanged = 0;
+
+            if (uniform && (tile->count != 1 || tile->color[0] != first->color[0] ||
+                            tile->color[1] != first->color[1] || tile->color[2] != first->color[2]))
+                uniform = 0;
+
+            if (!unchanged && !uniform)
+                return BLOCK_SPLIT;
+        }
+    }
+
+    return unchanged ? BLOCK_UNCHANGED : BLOCK_UNIFORM;
+}
+
+static int
+run_write(tycho_band_t *const restrict band,
+          buffer_t *const restrict buffer)
+{
+    const unsigned n = band->skip + 1;
+    const unsigned c = 31 - CLZ(n);
+    const unsigned q = DIV(c, 4);
+
+    if (!band->step) {
+        if (encode(&band->coder, buffer, &band->run.model, c, 5, band->run.ctx))
+            return 1;
+        band->run.ctx = c;
+        band->step = 1;
+    }
+
+    for (; band->step <= q; band->step++) {
+        const unsigned s = 4 * (q - band->step);
+        const uint8_t v = ((n & ((1u << c) - 1)) >> s) & 0xF;
+        if (encode(&band->coder, buffer, &band->span.model, v, 4, band->step == 1 ? c : 0))
+            return 1;
+    }
+
+    band->step = 0;
+    return 0;
+}
+
+static unsigned
+run_length(tycho_t *const restrict tycho,
+           const tycho_band_t *const restrict band)
 {
-    const size_t count = tycho->tiles.wn * tycho->tiles.hn;
+    const unsigned wn = tycho->tiles.wn;
+    const unsigned mask = (1u << tycho->block.size) - 1;
+    unsigned n = 0;
+
+    if (tycho->redraw)
+        return 0;
+
+    for (unsigned k = band->tile; k < band->end; k++) {
+        const unsigned j = k / wn;
+        const unsigned i = k % wn;
+        unsigned last = i ? k : k + wn - 1;
+
+        if (tycho->block.size) {
+            last = j * wn + MIN(i | mask, wn - 1);
+            if (*block_mode(tycho, j, i) != BLOCK_SPLIT) {
+                k = last;
+                continue;
+            }
+        }
+
+        if (last > k && global.row[j] <= tycho->sync) {
+            n += last - k + 1;
+            k = last;
+            continue;
+        }
+
+        if (!tile_same(tycho, k))
+            break;
+
+        n++;
+    }
+
+    return n;
+}
+
+static void
+blocks_get(tycho_t *const restrict tycho,
+           const tycho_band_t *const restrict band)
+{
+    const unsigned wn = tycho->tiles.wn;
+    const unsigned hn = tycho->tiles.hn;
+    const unsigned size = 1u << tycho->block.size;
+
+    for (unsigned j = band->tile / wn; j < band->end / wn; j += size) {
+        int unchanged = !tycho->redraw;
+
+        for (unsigned r = j; r < MIN(j + size, hn) && unchanged; r++)
+            unchanged = global.row[r] <= tycho->sync;
+
+        for (unsigned i = 0; i < wn; i += size)
+            *block_mode(tycho, j, i) = unchanged ? BLOCK_UNCHANGED : block_get(tycho, j, i);
+    }
+}
+
+static int
+band_send(tycho_band_t *const restrict band,
+          tycho_t *const restrict tycho,
+          buffer_t *const restrict buffer)
+{
+    const unsigned wn = tycho->tiles.wn;
+    const unsigned mask = (1u << tycho->block.size) - 1;
+
+    for (; band->tile < band->end; band->tile++) {
+        const unsigned k = band->tile;
+        int full = tycho->redraw;
+        int split = 1;
+
+        if (tycho->block.size) {
+            const unsigned j = band->tile / wn;
+            const unsigned i = band->tile % wn;
+            const int origin = !((j | i) & mask);
+            const uint8_t mode = *block_mode(tycho, j, i);
+
+            if (origin && !band->origin) {
+                if (encode(&band->coder, buffer, &band->block.model, mode, 2, band->block.ctx))
+                    return 1;
+                band->block.ctx = mode;
+                band->origin = 1;
+            }
+
+            if (mode == BLOCK_UNCHANGED || (mode == BLOCK_UNIFORM && !origin)) {
+                if (mode == BLOCK_UNIFORM)
+                    tycho->gen[k] = global.gen[k];
+                band->origin = 0;
+                continue;
+            }
+
+            if (mode == BLOCK_UNIFORM) {
+                full = 1;
+                split = 0;
+            }
+        }
+
+        if (tycho->run && split) {
+            if (!band->gap) {
+                if (!band->step)
+                    band->skip = run_length(tycho, band);
+                if (run_write(band, buffer))
+                    return 1;
+                band->gap = 1;
+            }
+            if (band->skip) {
+                if (tycho->block.size) {
+                    band->skip--;
+                } else {
+                    band->tile += band->skip - 1;
+                    band->skip = 0;
+                }
+                band->origin = 0;
+                continue;
+            }
+        }
+
+        const int same = !full && tile_same(tycho, k);
+        const int copy = !full && tycho->move.w && global.move.map[k];
+
+        int ret = buffer_write_tile(band, buffer, &global.tiles.tile[k], same, copy);
 
-    for (; tycho->tile < count; tycho->tile++) {
-        int ret = buffer_write_tile(tycho, buffer,
-                                    &tycho->tiles.tile[tycho->tile],
-                                    &tycho->tiles_old.tile[tycho->tile]);
         if (ret == 1)
             return 1;
+
+        if (!same)
+            tycho->gen[k] = global.gen[k];
+
+        band->origin = 0;
+
+        if (split)
+            band->gap = 0;
     }
 
-    if (tycho->flush) {
-        if (encoder_flush(&tycho->coder, buffer))
+    if (band->flush) {
+        if (encoder_flush(&band->coder, buffer))
             return 1;
-        tycho->flush = 0;
+        band->flush = 0;
     }
 
     return 0;
 }
+
+static void
+band_encode(void *data, unsigned k)
+{
+    tycho_t *const tycho = data;
+    tycho_band_t *const band = &tycho->band[k];
+    buffer_t *const buffer = &band->buffer;
+
+    if (!buffer->data)
+        buffer_setup(buffer, NULL, 65536);
+
+    buffer_format(buffer);
+
+    if (tycho->block.size)
+        blocks_get(tycho, band);
+
+    while (band_send(band, tycho, buffer))
+        buffer_resize(buffer, buffer_size(buffer) << 1);
+}
+
+static tycho_frame_t *
+frame_encode(tycho_t *tycho)
+{
+    worker_run(band_encode, tycho, tycho->bands);
+
+    size_t size = 13 + 4 * tycho->bands;
+
+    for (unsigned k = 0; k < tycho->bands; k++)
+        size += buffer_read_size(&tycho->band[k].buffer);
+
+    tycho_frame_t *frame = tycho_frame_create(size);
+
+    buffer_write(&frame->buffer, !!tycho->cache.size);
+    buffer_write_16(&frame->buffer, tycho->move.x);
+    buffer_write_16(&frame->buffer, tycho->move.y);
+    buffer_write_16(&frame->buffer, tycho->move.w);
+    buffer_write_16(&frame->buffer, tycho->move.h);
+    buffer_write_16(&frame->buffer, tycho->move.dx);
+    buffer_write_16(&frame->buffer, tycho->move.dy);
+
+    for (unsigned k = 0; k < tycho->bands; k++)
+        buffer_write_32(&frame->buffer, buffer_read_size(&tycho->band[k].buffer));
+
+    for (unsigned k = 0; k < tycho->bands; k++)
+        buffer_copy(&frame->buffer, &tycho->band[k].buffer);
+
+    if (!tycho->quality.skip)
+        tycho->sync = tycho->serial;
+
+    return frame;
+}
+
+void
+tycho_set_shared(int use)
+{
+    global.shared.use = use;
+}
+
+void
+tycho_set_bands(unsigned bands)
+{
+    global.bands = CLAMP(bands, 1, BAND_MAX);
+}
+
+void
+tycho_set_coder(unsigned coder)
+{
+    global.coder = coder;
+}
+
+void
+tycho_set_block(unsigned block)
+{
+    global.block = MIN(block, BLOCK_MAX);
+}
+
+void
+tycho_set_run(unsigned run)
+{
+    global.run = !!run;
+}
+
+void
+tycho_set_cache(size_t size)
+{
+    global.cache = size;
+}
+
+static void
+tiles_setup(tycho_t *tycho)
+{
+    unsigned cache = 0;
+
+    if (tycho != &global.shared.tycho) {
+        const size_t slots = global.cache / global.bands / sizeof(tycho_tile_t);
+        cache = slots ? 31 - CLZ(MIN(slots, 1u << CACHE_MAX)) : 0;
+    }
+
+    tycho->redraw = tycho_tiles_setup(&tycho->tiles, global.tiles.w, global.tiles.h);
+
+    tycho_setup_bands(tycho, global.bands, global.coder, global.block, global.run, cache);
+
+    if (tycho->redraw || !tycho->gen) {
+        safe_free(tycho->gen);
+        tycho->gen = safe_calloc(tycho->tiles.wn * tycho->tiles.hn, sizeof(uint32_t));
+    }
+
+    tycho->move.w = 0;
+    tycho->move.h = 0;
+
+    if (tycho->serial && tycho->serial == global.move.serial &&
+            global.serial == global.move.serial + 1 &&
+            global.move.rect.w && !tycho->redraw && !tycho->quality.skip) {
+        tycho->move.x = global.move.rect.x;
+        tycho->move.y = global.move.rect.y;
+        tycho->move.w = global.move.rect.w;
+        tycho->move.h = global.move.rect.h;
+        tycho->move.dx = global.move.dx;
+        tycho->move.dy = global.move.dy;
+    }
+
+    tycho->serial = global.serial;
+    tycho->quality.limit = 0;
+    tycho->quality.skip = 0;
+}
+
+static void
+tiles_limit(tycho_t *tycho)
+{
+    const unsigned range = global.quality.max - global.quality.min;
+
+    if (tycho->quality.drop > range)
+        tycho->quality.drop = range;
+
+    if (!tycho->quality.drop || tycho->redraw)
+        return;
+
+    tycho->quality.limit = global.quality.max - tycho->quality.drop;
+
+    const unsigned wn = tycho->tiles.wn;
+    const unsigned hn = tycho->tiles.hn;
+    unsigned skip = 0;
+
+    for (unsigned j = 0; j < hn; j++) {
+        if (global.row[j] <= tycho->sync)
+            continue;
+
+        for (unsigned k = j * wn; k < (j + 1) * wn; k++)
+            skip += tycho->gen[k] != global.gen[k] && tile_same(tycho, k);
+    }
+
+    tycho->quality.skip = skip;
+}
+
+static void
+output_setup(tycho_t *tycho, tycho_frame_t *frame)
+{
+    tycho->output.frame = frame;
+    tycho->output.read = frame->buffer;
+}
+
+static void
+gen_copy(tycho_t *dst, const tycho_t *src)
+{
+    const unsigned count = src->tiles.wn * src->tiles.hn;
+
+    if (dst->tiles.wn * dst->tiles.hn != count || !dst->gen) {
+        safe_free(dst->gen);
+        dst->gen = safe_malloc(count * sizeof(uint32_t));
+    }
+
+    dst->tiles.w = src->tiles.w;
+    dst->tiles.h = src->tiles.h;
+    dst->tiles.wn = src->tiles.wn;
+    dst->tiles.hn = src->tiles.hn;
+    dst->sync = src->sync;
+
+    byte_copy(dst->gen, src->gen, count * sizeof(uint32_t));
+}
+
+static void
+shared_encode(tycho_t *from)
+{
+    tycho_t *const shared = &global.shared.tycho;
+
+    int reset = !global.shared.frame || from;
+
+    if (from && from->serial != shared->serial) {
+        gen_copy(shared, from);
+        shared->serial = from->serial;
+    }
+
+    if (reset) {
+        tycho_reset(shared);
+        global.shared.reset = global.serial;
+    }
+
+    global.shared.base = shared->serial;
+
+    tiles_setup(shared);
+
+    tycho_frame_t *frame = frame_encode(shared);
+
+    frame->serial = shared->serial;
+    frame->reset = reset;
+    frame->shared = 1;
+
+    tycho_frame_release(global.shared.frame);
+    global.shared.frame = frame;
+}
+
+static int
+shared_setup(tycho_t *tycho, tycho_frame_t *last)
+{
+    tycho_t *const shared = &global.shared.tycho;
+
+    if (!tycho->serial || tycho->quality.drop)
+        return 0;
+
+    if (shared->serial != global.serial) {
+        tycho_frame_t *const frame = global.shared.frame;
+
+        if (frame && last == frame) {
+            shared_encode(NULL);
+        } else if (!frame || frame->ref == 1) {
+            shared_encode(tycho);
+        } else if (tycho->serial == shared->serial &&
+                   global.serial - global.shared.reset >= CONFIG_SHARED_RESET) {
+            shared_encode(tycho);
+        } else {
+            return 0;
+        }
+    }
+
+    tycho_frame_t *const frame = global.shared.frame;
+
+    if (tycho->serial != global.shared.base)
+        return 0;
+
+    if (!frame->reset && (!last || last->serial != global.shared.base))
+        return 0;
+
+    frame->ref++;
+
+    output_setup(tycho, frame);
+    tycho->reset = frame->reset;
+
+    return 1;
+}
+
+void
+tycho_setup_server(tycho_t *tycho)
+{
+    tycho_frame_t *last = tycho->output.frame;
+
+    tycho->output.frame = NULL;
+    tycho->reset = 0;
+
+    if (last && !last->shared)
+        last = tycho_frame_release(last);
+
+    if (!global.shared.use || !shared_setup(tycho, last)) {
+        if (last) {
+            tycho_reset(tycho);
+            tycho->reset = 1;
+        }
+
+        tiles_setup(tycho);
+        tiles_limit(tycho);
+        output_setup(tycho, frame_encode(tycho));
+    } else {
+        tiles_setup(tycho);
+        gen_copy(tycho, &global.shared.tycho);
+    }
+
+    tycho_frame_release(last);
+}
+
+int
+tycho_send(tycho_t *tycho, buffer_t *buffer)
+{
+    if (!tycho->output.frame)
+        return 0;
+
+    buffer_copy(buffer, &tycho->output.read);
+
+    return !!buffer_read_size(&tycho->output.read);
+}
+
+buffer_t *
+tycho_output(tycho_t *tycho)
+{
+    if (!tycho->output.frame)
+        return NULL;
+
+    return &tycho->output.read;
+}
+
+tycho_tiles_t *
+tycho_get_tiles(void)
+{
+    return &global.tiles;
+}
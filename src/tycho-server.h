@@ -2,7 +2,17 @@
 
 #include "tycho.h"
 
-void tycho_setup_server  (tycho_t *);
-int  tycho_send          (tycho_t *, buffer_t *);
-int  tycho_set_image     (image_info_t *);
-void tycho_set_quality   (unsigned, unsigned);
+void           tycho_setup_server (tycho_t *);
+int            tycho_send         (tycho_t *, buffer_t *);
+buffer_t      *tycho_output       (tycho_t *);
+tycho_tiles_t *tycho_get_tiles    (void);
+int            tycho_set_image    (image_info_t *);
+void           tycho_set_quality  (unsigned, unsigned);
+void           tycho_set_shared   (int);
+void           tycho_set_bands    (unsigned);
+void           tycho_set_coder    (unsigned);
+void           tycho_set_block    (unsigned);
+void           tycho_set_run      (unsigned);
+void           tycho_set_cache    (size_t);
+void           tycho_set_damage   (int, int, int, int);
+int            tycho_pending      (void);
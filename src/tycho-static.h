@@ -3,6 +3,10 @@
 #include "tycho.h"
 #include "buffer-static.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 static inline void update_lim (tycho_coder_t *const restrict coder)
 {
     coder->lim[0]<<=8;
@@ -22,11 +26,12 @@ static inline int32_t update_p (int32_t p, int32_t bit)
     return p+(((bit<<16)-p)>>6);
 }
 
-static inline void coder_setup (tycho_coder_t *coder)
+static inline void coder_setup (tycho_coder_t *coder, unsigned type)
 {
     coder->lim[0] = 0;
     coder->lim[1] = ~0;
     coder->k = 1;
+    coder->type = type;
 }
 
 static inline int encoder_flush (tycho_coder_t *coder, buffer_t *buffer)
@@ -34,7 +39,7 @@ static inline int encoder_flush (tycho_coder_t *coder, buffer_t *buffer)
     if (buffer_write_size(buffer)<4)
         return 1;
 
-    buffer_write_32(buffer, coder->lim[1]);
+    buffer_write_32(buffer, coder->lim[coder->type!=CODER_RANGE]);
 
     return 0;
 }
@@ -49,12 +54,12 @@ static inline int decoder_flush (tycho_coder_t *coder, buffer_t *buffer)
     return 0;
 }
 
-static inline int decode (tycho_coder_t *const restrict coder,
-                          buffer_t *const restrict buffer,
-                          tycho_model_t *const restrict model,
-                          uint8_t *const restrict byte,
-                          const int min,
-                          const uint32_t ctx)
+static inline int binary_decode (tycho_coder_t *const restrict coder,
+                                 buffer_t *const restrict buffer,
+                                 tycho_model_t *const restrict model,
+                                 uint8_t *const restrict byte,
+                                 const int min,
+                                 const uint32_t ctx)
 {
     uint16_t *const restrict p = &model->p[ctx<<model->bits];
     int k = coder->k;
@@ -85,12 +90,12 @@ static inline int decode (tycho_coder_t *const restrict coder,
     return 0;
 }
 
-static inline int encode (tycho_coder_t *const restrict coder,
-                          buffer_t *const restrict buffer,
-                          tycho_model_t *const restrict model,
-                          const uint8_t byte,
-                          const int min,
-                          const uint32_t ctx)
+static inline int binary_encode (tycho_coder_t *const restrict coder,
+                                 buffer_t *const restrict buffer,
+                                 tycho_model_t *const restrict model,
+                                 const uint8_t byte,
+                                 const int min,
+                                 const uint32_t ctx)
 {
     uint16_t *const restrict p = &model->p[ctx<<model->bits];
     int k = coder->k;
@@ -118,3 +123,331 @@ static inline int encode (tycho_coder_t *const restrict coder,
 
     return 0;
 }
+
+#define RANGE_TOP  (1u<<24)
+#define RANGE_BOT  (1u<<16)
+#define RANGE_BITS 15
+#define RANGE_MIN  4
+#define RANGE_RATE 4
+#define RANGE_HITS 16
+
+static inline int range_rate (uint16_t *const restrict cdf, const unsigned n)
+{
+    const unsigned hits = cdf[RANGE_HITS];
+
+    cdf[RANGE_HITS] = hits+(hits<32);
+
+    return RANGE_RATE+(hits>15)+(hits>31)+(n>4);
+}
+
+_const_
+static inline uint32_t range_scale (const uint32_t c, const unsigned i, const unsigned n)
+{
+    return ((c*((1u<<RANGE_BITS)-n*RANGE_MIN))>>RANGE_BITS)+i*RANGE_MIN;
+}
+
+#ifdef __SSE2__
+static inline void range_update (uint16_t *const restrict cdf, const unsigned s, const unsigned n)
+{
+    const __m128i i0 = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i i1 = _mm_setr_epi16(8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i vs = _mm_set1_epi16(s);
+    const __m128i vt = _mm_set1_epi16((1<<RANGE_BITS)-1);
+    const __m128i t0 = _mm_and_si128(_mm_cmpgt_epi16(i0, vs), vt);
+    const __m128i t1 = _mm_and_si128(_mm_cmpgt_epi16(i1, vs), vt);
+    const __m128i c0 = _mm_loadu_si128((const __m128i *)&cdf[0]);
+    const __m128i c1 = _mm_loadu_si128((const __m128i *)&cdf[8]);
+    const __m128i r = _mm_cvtsi32_si128(range_rate(cdf, n));
+
+    _mm_storeu_si128((__m128i *)&cdf[0], _mm_add_epi16(c0, _mm_sra_epi16(_mm_sub_epi16(t0, c0), r)));
+    _mm_storeu_si128((__m128i *)&cdf[8], _mm_add_epi16(c1, _mm_sra_epi16(_mm_sub_epi16(t1, c1), r)));
+}
+
+static inline unsigned range_find (const uint16_t *const restrict cdf, const uint16_t v, const unsigned n,
+                                   uint32_t *const restrict start, uint32_t *const restrict end)
+{
+    const __m128i m0 = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i m1 = _mm_setr_epi16(8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i vm = _mm_set1_epi16(RANGE_MIN);
+    const __m128i vs = _mm_set1_epi16(((1<<RANGE_BITS)-n*RANGE_MIN)<<1);
+    const __m128i vv = _mm_set1_epi16(v);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c0 = _mm_add_epi16(_mm_mulhi_epu16(_mm_loadu_si128((const __m128i *)&cdf[0]), vs), _mm_mullo_epi16(m0, vm));
+    const __m128i c1 = _mm_add_epi16(_mm_mulhi_epu16(_mm_loadu_si128((const __m128i *)&cdf[8]), vs), _mm_mullo_epi16(m1, vm));
+    const unsigned m = _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(_mm_subs_epu16(c0, vv), zero),
+                                                         _mm_cmpeq_epi16(_mm_subs_epu16(c1, vv), zero)));
+    const unsigned k = CTZ(~(m&((1u<<n)-1)))-1;
+
+    uint16_t c[17];
+
+    _mm_storeu_si128((__m128i *)&c[0], c0);
+    _mm_storeu_si128((__m128i *)&c[8], c1);
+    c[n] = 1u<<RANGE_BITS;
+
+    *start = c[k];
+    *end = c[k+1];
+
+    return k;
+}
+#else
+static inline void range_update (uint16_t *const restrict cdf, const unsigned s, const unsigned n)
+{
+    const int r = range_rate(cdf, n);
+
+    for (unsigned i=1; i<n; i++) {
+        const int16_t t = i<=s ? 0 : (1<<RANGE_BITS)-1;
+        cdf[i] += (int16_t)(t-(int16_t)cdf[i])>>r;
+    }
+}
+
+static inline unsigned range_find (const uint16_t *const restrict cdf, const uint16_t v, const unsigned n,
+                                   uint32_t *const restrict start, uint32_t *const restrict end)
+{
+    unsigned k = 0;
+
+    *end = 1u<<RANGE_BITS;
+
+    for (; k+1<n; k++) {
+        const uint32_t c = range_scale(cdf[k+1], k+1, n);
+        if (c>v) {
+            *end = c;
+            break;
+        }
+    }
+
+    *start = range_scale(cdf[k], k, n);
+
+    return k;
+}
+#endif
+
+static inline int range_encode_symbol (tycho_coder_t *const restrict coder,
+                                       buffer_t *const restrict buffer,
+                                       uint16_t *const restrict cdf,
+                                       const unsigned s,
+                                       const unsigned n)
+{
+    uint32_t low = coder->lim[0];
+    uint32_t range = coder->lim[1];
+
+    while (1) {
+        if ((low^(low+range))>=RANGE_TOP) {
+            if (range>=RANGE_BOT)
+                break;
+            range = -low&(RANGE_BOT-1);
+        }
+        if _0_(buffer_write_size(buffer)<1) {
+            coder->lim[0] = low;
+            coder->lim[1] = range;
+            return 1;
+        }
+        buffer_write(buffer, low>>24);
+        low <<= 8;
+        range <<= 8;
+    }
+
+    const uint32_t r = range>>RANGE_BITS;
+    const uint32_t start = range_scale(cdf[s], s, n);
+    const uint32_t end = s+1<n ? range_scale(cdf[s+1], s+1, n) : 1u<<RANGE_BITS;
+
+    coder->lim[0] = low+start*r;
+    coder->lim[1] = (end-start)*r;
+
+    range_update(cdf, s, n);
+
+    return 0;
+}
+
+static inline int range_decode_symbol (tycho_coder_t *const restrict coder,
+                                       buffer_t *const restrict buffer,
+                                       uint16_t *const restrict cdf,
+                                       unsigned *const restrict s,
+                                       const unsigned n)
+{
+    uint32_t low = coder->lim[0];
+    uint32_t range = coder->lim[1];
+
+    while (1) {
+        if ((low^(low+range))>=RANGE_TOP) {
+            if (range>=RANGE_BOT)
+                break;
+            range = -low&(RANGE_BOT-1);
+        }
+        if _0_(buffer_read_size(buffer)<1) {
+            coder->lim[0] = low;
+            coder->lim[1] = range;
+            return 1;
+        }
+        coder->x = (coder->x<<8)|buffer_read(buffer);
+        low <<= 8;
+        range <<= 8;
+    }
+
+    const uint32_t r = range>>RANGE_BITS;
+    const uint16_t v = MIN((coder->x-low)/r, (1u<<RANGE_BITS)-1);
+
+    uint32_t start, end;
+
+    const unsigned k = range_find(cdf, v, n, &start, &end);
+
+    coder->lim[0] = low+start*r;
+    coder->lim[1] = (end-start)*r;
+
+    range_update(cdf, k, n);
+
+    *s = k;
+
+    return 0;
+}
+
+static inline int range_encode (tycho_coder_t *const restrict coder,
+                                buffer_t *const restrict buffer,
+                                tycho_model_t *const restrict model,
+                                const uint8_t byte,
+                                _unused_ const int min,
+                                const uint32_t ctx)
+{
+    uint16_t *const restrict cdf = &model->p[ctx*model->size];
+
+    if (model->bits<=4)
+        return range_encode_symbol(coder, buffer, cdf, byte, 1u<<model->bits);
+
+    const unsigned hi = byte>>4;
+
+    if (coder->k==1) {
+        if (range_encode_symbol(coder, buffer, cdf, hi, 16))
+            return 1;
+        coder->k = 16|hi;
+    }
+
+    if (range_encode_symbol(coder, buffer, cdf+(hi+1)*17, byte&15, 16))
+        return 1;
+
+    coder->k = 1;
+
+    return 0;
+}
+
+static inline int range_decode (tycho_coder_t *const restrict coder,
+                                buffer_t *const restrict buffer,
+                                tycho_model_t *const restrict model,
+                                uint8_t *const restrict byte,
+                                _unused_ const int min,
+                                const uint32_t ctx)
+{
+    uint16_t *const restrict cdf = &model->p[ctx*model->size];
+    unsigned s;
+
+    if (model->bits<=4) {
+        if (range_decode_symbol(coder, buffer, cdf, &s, 1u<<model->bits))
+            return 1;
+        *byte = s;
+        return 0;
+    }
+
+    if (coder->k==1) {
+        if (range_decode_symbol(coder, buffer, cdf, &s, 16))
+            return 1;
+        coder->k = 16|s;
+    }
+
+    const unsigned hi = coder->k&15;
+
+    if (range_decode_symbol(coder, buffer, cdf+(hi+1)*17, &s, 16))
+        return 1;
+
+    *byte = (hi<<4)|s;
+
+    coder->k = 1;
+
+    return 0;
+}
+
+static inline int encode (tycho_coder_t *const restrict coder,
+                          buffer_t *const restrict buffer,
+                          tycho_model_t *const restrict model,
+                          const uint8_t byte,
+                          const int min,
+                          const uint32_t ctx)
+{
+    if (model->coder==CODER_RANGE)
+        return range_encode(coder, buffer, model, byte, min, ctx);
+
+    return binary_encode(coder, buffer, model, byte, min, ctx);
+}
+
+static inline int decode (tycho_coder_t *const restrict coder,
+                          buffer_t *const restrict buffer,
+                          tycho_model_t *const restrict model,
+                          uint8_t *const restrict byte,
+                          const int min,
+                          const uint32_t ctx)
+{
+    if (model->coder==CODER_RANGE)
+        return range_decode(coder, buffer, model, byte, min, ctx);
+
+    return binary_decode(coder, buffer, model, byte, min, ctx);
+}
+
+static inline uint8_t *block_mode (tycho_t *const restrict tycho,
+                                   const unsigned j, const unsigned i)
+{
+    const unsigned s = tycho->block.size;
+    return &tycho->block.mode[(j>>s)*tycho->block.wn+(i>>s)];
+}
+
+_pure_
+static inline unsigned cache_index (const tycho_cache_t *const restrict cache, const uint32_t key)
+{
+    return (key*2654435761u)>>(31-CTZ(cache->size));
+}
+
+static inline void cache_use (tycho_cache_t *const restrict cache, const unsigned slot)
+{
+    const unsigned head = cache->head;
+
+    if (slot==head)
+        return;
+
+    cache->next[cache->prev[slot]] = cache->next[slot];
+    cache->prev[cache->next[slot]] = cache->prev[slot];
+
+    cache->next[slot] = head;
+    cache->prev[slot] = cache->prev[head];
+    cache->next[cache->prev[head]] = slot;
+    cache->prev[head] = slot;
+    cache->head = slot;
+}
+
+static inline void cache_add (tycho_cache_t *const restrict cache,
+                              const tycho_tile_t *const restrict tile,
+                              const uint32_t key)
+{
+    unsigned slot;
+
+    if (cache->used<cache->size) {
+        slot = cache->used++;
+        cache->next[slot] = slot;
+        cache->prev[slot] = slot;
+        if (slot) {
+            cache->next[slot] = cache->head;
+            cache->prev[slot] = cache->prev[cache->head];
+            cache->next[cache->prev[cache->head]] = slot;
+            cache->prev[cache->head] = slot;
+        }
+        cache->head = slot;
+    } else {
+        slot = cache->prev[cache->head];
+        const unsigned k = cache_index(cache, cache->key[slot]);
+        if (cache->table[k]==slot+1)
+            cache->table[k] = 0;
+        cache_use(cache, slot);
+    }
+
+    byte_copy(&cache->tile[slot], tile, sizeof(tycho_tile_t));
+
+    cache->key[slot] = key;
+
+    if (key)
+        cache->table[cache_index(cache, key)] = slot+1;
+}
@@ -31,6 +31,24 @@ tycho_tiles_delete(tycho_tiles_t *tiles)
     byte_set(tiles, 0, sizeof(tycho_tiles_t));
 }
 
+int
+tycho_tiles_setup(tycho_tiles_t *tiles, unsigned w, unsigned h)
+{
+    if (!tiles)
+        return 0;
+
+    if (w == tiles->w && h == tiles->h)
+        return 0;
+
+    tiles->w = w;
+    tiles->h = h;
+
+    tiles->wn = DIV(w, TILE_SIZE);
+    tiles->hn = DIV(h, TILE_SIZE);
+
+    return 1;
+}
+
 int
 tycho_tiles_resize(tycho_tiles_t *tiles, unsigned w, unsigned h)
 {
@@ -52,6 +70,9 @@ tycho_tiles_resize(tycho_tiles_t *tiles, unsigned w, unsigned h)
     const tycho_tiles_t old = *tiles;
     tycho_tiles_create(tiles, w, h);
 
+    if (!old.tile)
+        return 1;
+
     const unsigned jj = MIN(hn, old.hn);
     const unsigned ii = MIN(wn, old.wn);
 
@@ -87,20 +108,49 @@ tycho_tiles_copy(tycho_tiles_t *dst, tycho_tiles_t *src)
 }
 
 void
-tycho_model_create(tycho_model_t *model, unsigned bits, unsigned mask)
+tycho_model_create(tycho_model_t *model, unsigned bits, unsigned mask, unsigned coder)
 {
     if (!model)
         return;
 
-    const unsigned count = (1 << bits) * (mask + 1);
+    unsigned size = 1 << bits;
 
-    model->p = safe_malloc(sizeof(uint16_t) * count);
-
-    for (unsigned i = 0; i < count; i++)
-        model->p[i] = 1u << 15;
+    if (coder == CODER_RANGE)
+        size = bits > 4 ? 17 * 17 : 17;
 
+    model->p = safe_malloc(sizeof(uint16_t) * size * (mask + 1));
     model->bits = bits;
     model->mask = mask;
+    model->size = size;
+    model->coder = coder;
+
+    tycho_model_reset(model);
+}
+
+void
+tycho_model_reset(tycho_model_t *model)
+{
+    if (!model || !model->p)
+        return;
+
+    const unsigned count = model->size * (model->mask + 1);
+
+    if (model->coder == CODER_RANGE) {
+        const unsigned n = 1u << MIN(model->bits, 4);
+        for (unsigned i = 0; i < count; i++) {
+            const unsigned k = i % 17;
+            if (k == RANGE_HITS)
+                model->p[i] = 0;
+            else if (k < n)
+                model->p[i] = (k << RANGE_BITS) / n;
+            else
+                model->p[i] = (1u << RANGE_BITS) - 1;
+        }
+        return;
+    }
+
+    for (unsigned i = 0; i < count; i++)
+        model->p[i] = 1u << 15;
 }
 
 void
@@ -114,20 +164,204 @@ tycho_model_delete(tycho_model_t *model)
     byte_set(model, 0, sizeof(tycho_model_t));
 }
 
+static void
+cache_create(tycho_cache_t *cache, unsigned size)
+{
+    byte_set(cache, 0, sizeof(tycho_cache_t));
+
+    if (!size)
+        return;
+
+    cache->size = 1u << size;
+    cache->tile = safe_malloc(cache->size * sizeof(tycho_tile_t));
+    cache->key = safe_malloc(cache->size * sizeof(uint32_t));
+    cache->table = safe_calloc(2 * cache->size, sizeof(uint32_t));
+    cache->prev = safe_malloc(cache->size * sizeof(uint16_t));
+    cache->next = safe_malloc(cache->size * sizeof(uint16_t));
+}
+
+static void
+cache_delete(tycho_cache_t *cache)
+{
+    safe_free(cache->tile);
+    safe_free(cache->key);
+    safe_free(cache->table);
+    safe_free(cache->prev);
+    safe_free(cache->next);
+
+    byte_set(cache, 0, sizeof(tycho_cache_t));
+}
+
+static void
+band_create(tycho_band_t *band, unsigned coder, unsigned cache)
+{
+    tycho_model_create(&band->count.model, 4, 0xFFF, coder);
+    tycho_model_create(&band->block.model, 2, 0x3, coder);
+    tycho_model_create(&band->slot.model, 8, 0, coder);
+    tycho_model_create(&band->run.model, 5, 0x1F, coder);
+    tycho_model_create(&band->span.model, 4, 0x1F, coder);
+
+    for (size_t i = 0; i < COUNT(band->color); i++)
+        tycho_model_create(&band->color[i].model, 8, 0xFF, coder);
+
+    for (size_t i = 0; i < COUNT(band->index.model); i++)
+        tycho_model_create(&band->index.model[i], 32 - CLZ(i + 1), 0xFFF, coder);
+
+    cache_create(&band->cache, cache);
+}
+
+static void
+band_reset(tycho_band_t *band)
+{
+    tycho_model_reset(&band->count.model);
+    band->count.ctx = 0;
+
+    tycho_model_reset(&band->block.model);
+    band->block.ctx = 0;
+
+    tycho_model_reset(&band->slot.model);
+
+    tycho_model_reset(&band->run.model);
+    band->run.ctx = 0;
+
+    tycho_model_reset(&band->span.model);
+
+    for (size_t i = 0; i < COUNT(band->color); i++) {
+        tycho_model_reset(&band->color[i].model);
+        band->color[i].ctx = 0;
+    }
+
+    for (size_t i = 0; i < COUNT(band->index.model); i++)
+        tycho_model_reset(&band->index.model[i]);
+
+    byte_set(&band->state, 0, sizeof(tycho_state_t));
+}
+
+static void
+band_delete(tycho_band_t *band)
+{
+    tycho_model_delete(&band->count.model);
+    tycho_model_delete(&band->block.model);
+    tycho_model_delete(&band->slot.model);
+    tycho_model_delete(&band->run.model);
+    tycho_model_delete(&band->span.model);
+
+    for (size_t i = 0; i < COUNT(band->color); i++)
+        tycho_model_delete(&band->color[i].model);
+
+    for (size_t i = 0; i < COUNT(band->index.model); i++)
+        tycho_model_delete(&band->index.model[i]);
+
+    cache_delete(&band->cache);
+
+    safe_free(band->buffer.data);
+
+    byte_set(band, 0, sizeof(tycho_band_t));
+}
+
+static void
+bands_delete(tycho_t *tycho)
+{
+    for (unsigned k = 0; k < tycho->bands; k++)
+        band_delete(&tycho->band[k]);
+
+    tycho->band = safe_free(tycho->band);
+    tycho->bands = 0;
+    tycho->created = 0;
+}
+
+static void
+blocks_setup(tycho_t *tycho, unsigned size)
+{
+    const unsigned wn = size ? DIV(tycho->tiles.wn, 1u << size) : 0;
+    const unsigned hn = size ? DIV(tycho->tiles.hn, 1u << size) : 0;
+
+    const unsigned count = wn * hn;
+
+    tycho->block.size = size;
+    tycho->block.wn = wn;
+
+    if (tycho->block.count == count)
+        return;
+
+    safe_free(tycho->block.mode);
+
+    tycho->block.mode = count ? safe_calloc(count, 1) : NULL;
+    tycho->block.count = count;
+}
+
 void
-tycho_setup(tycho_t *tycho, unsigned w, unsigned h)
+tycho_setup_bands(tycho_t *tycho, unsigned bands, unsigned coder,
+                  unsigned block, unsigned run, unsigned cache)
 {
     if (!tycho)
         return;
 
-    if (!tycho->created)
+    bands = CLAMP(bands, 1, BAND_MAX);
+    coder = coder == CODER_RANGE ? CODER_RANGE : CODER_BINARY;
+    cache = MIN(cache, CACHE_MAX);
+
+    if (tycho->created && (tycho->bands != bands || tycho->coder != coder))
+        bands_delete(tycho);
+
+    if (tycho->created && tycho->cache.size != cache) {
+        for (unsigned k = 0; k < tycho->bands; k++) {
+            cache_delete(&tycho->band[k].cache);
+            cache_create(&tycho->band[k].cache, cache);
+        }
+    }
+
+    tycho->cache.size = cache;
+
+    if (!tycho->created) {
+        tycho->bands = bands;
+        tycho->coder = coder;
         tycho_create(tycho);
+    }
 
-    coder_setup(&tycho->coder);
+    tycho->run = !!run;
+    tycho->part = 0;
+
+    blocks_setup(tycho, MIN(block, BLOCK_MAX));
+
+    const unsigned wn = tycho->tiles.wn;
+    const unsigned hn = tycho->tiles.hn;
+    const unsigned size = tycho->block.size;
+    const unsigned rows = DIV(hn, 1u << size);
+
+    for (unsigned k = 0; k < tycho->bands; k++) {
+        tycho_band_t *const band = &tycho->band[k];
+        coder_setup(&band->coder, tycho->coder);
+        band->flush = 1;
+        band->origin = 0;
+        band->skip = 0;
+        band->gap = 0;
+        band->step = 0;
+        band->tile = MIN((k * rows / tycho->bands) << size, hn) * wn;
+        band->end = MIN(((k + 1) * rows / tycho->bands) << size, hn) * wn;
+    }
+}
+
+void
+tycho_setup(tycho_t *tycho, unsigned w, unsigned h, unsigned bands, unsigned coder,
+            unsigned block, unsigned run, unsigned cache)
+{
+    if (!tycho)
+        return;
 
-    tycho->flush = 1;
-    tycho->tile = 0;
     tycho->redraw = tycho_tiles_resize(&tycho->tiles, w, h);
+
+    tycho_setup_bands(tycho, bands, coder, block, run, cache);
+}
+
+void
+tycho_reset(tycho_t *tycho)
+{
+    if (!tycho || !tycho->created)
+        return;
+
+    for (unsigned k = 0; k < tycho->bands; k++)
+        band_reset(&tycho->band[k]);
 }
 
 void
@@ -136,13 +370,13 @@ tycho_create(tycho_t *tycho)
     if (!tycho)
         return;
 
-    tycho_model_create(&tycho->count.model, 4, 0xFFF);
+    if (!tycho->bands)
+        tycho->bands = 1;
 
-    for (size_t i = 0; i < COUNT(tycho->color); i++)
-        tycho_model_create(&tycho->color[i].model, 8, 0xFF);
+    tycho->band = safe_calloc(tycho->bands, sizeof(tycho_band_t));
 
-    for (size_t i = 0; i < COUNT(tycho->index.model); i++)
-        tycho_model_create(&tycho->index.model[i], 4, 0xFFF);
+    for (unsigned k = 0; k < tycho->bands; k++)
+        band_create(&tycho->band[k], tycho->coder, tycho->cache.size);
 
     tycho->created = 1;
 }
@@ -154,15 +388,52 @@ tycho_delete(tycho_t *tycho)
         return;
 
     tycho_tiles_delete(&tycho->tiles);
-    tycho_tiles_delete(&tycho->tiles_old);
 
-    tycho_model_delete(&tycho->count.model);
+    tycho_frame_release(tycho->output.frame);
 
-    for (size_t i = 0; i < COUNT(tycho->color); i++)
-        tycho_model_delete(&tycho->color[i].model);
+    safe_free(tycho->gen);
+    safe_free(tycho->block.mode);
+    safe_free(tycho->move.image.data);
 
-    for (size_t i = 0; i < COUNT(tycho->index.model); i++)
-        tycho_model_delete(&tycho->index.model[i]);
+    bands_delete(tycho);
 
     byte_set(tycho, 0, sizeof(tycho_t));
 }
+
+void
+tycho_cache_stat(tycho_t *tycho, unsigned *hit, unsigned *miss)
+{
+    *hit = 0;
+    *miss = 0;
+
+    if (!tycho || !tycho->created)
+        return;
+
+    for (unsigned k = 0; k < tycho->bands; k++) {
+        *hit += tycho->band[k].cache.hit;
+        *miss += tycho->band[k].cache.miss;
+    }
+}
+
+tycho_frame_t *
+tycho_frame_create(size_t size)
+{
+    tycho_frame_t *frame = safe_calloc(1, sizeof(tycho_frame_t));
+
+    buffer_setup(&frame->buffer, NULL, size);
+    frame->ref = 1;
+
+    return frame;
+}
+
+tycho_frame_t *
+tycho_frame_release(tycho_frame_t *frame)
+{
+    if (!frame || --frame->ref)
+        return NULL;
+
+    safe_free(frame->buffer.data);
+    safe_free(frame);
+
+    return NULL;
+}
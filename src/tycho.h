@@ -4,13 +4,28 @@
 
 #define TILE_SIZE  8
 #define COLOR_MAX 12
+#define BAND_MAX  64
+#define BLOCK_MAX  3
+#define TILE_COPY (COLOR_MAX+1)
+#define TILE_CACHE (COLOR_MAX+2)
+#define CACHE_MAX  16
+
+#define CODER_BINARY 0
+#define CODER_RANGE  1
+
+#define BLOCK_SPLIT     0
+#define BLOCK_UNCHANGED 1
+#define BLOCK_UNIFORM   2
 
 typedef struct tycho tycho_t;
+typedef struct tycho_band tycho_band_t;
 typedef struct tycho_state tycho_state_t;
 typedef struct tycho_coder tycho_coder_t;
 typedef struct tycho_model tycho_model_t;
 typedef struct tycho_tiles tycho_tiles_t;
 typedef struct tycho_tile  tycho_tile_t;
+typedef struct tycho_frame tycho_frame_t;
+typedef struct tycho_cache tycho_cache_t;
 
 struct tycho_tile {
     uint32_t hash;
@@ -33,6 +48,8 @@ struct tycho_tiles {
 struct tycho_model {
     unsigned bits;
     unsigned mask;
+    unsigned size;
+    unsigned coder;
     uint16_t *p;
 };
 
@@ -40,44 +57,127 @@ struct tycho_coder {
     uint32_t x;
     uint32_t lim[2];
     int k;
+    unsigned type;
 };
 
 struct tycho_state {
     uint8_t count;
     uint8_t i, j, k;
     uint8_t pmax;
+    uint16_t slot;
 };
 
-struct tycho {
-    tycho_tiles_t tiles;
-    tycho_tiles_t tiles_old;
+struct tycho_cache {
+    tycho_tile_t *tile;
+    uint32_t *key;
+    uint32_t *table;
+    uint16_t *prev;
+    uint16_t *next;
+    unsigned size;
+    unsigned used;
+    unsigned head;
+    unsigned hit;
+    unsigned miss;
+};
+
+struct tycho_frame {
+    buffer_t buffer;
+    unsigned serial;
+    unsigned ref;
+    uint8_t reset;
+    uint8_t shared;
+};
 
+struct tycho_band {
     unsigned tile;
+    unsigned end;
+    unsigned skip;
 
-    uint8_t created;
     uint8_t flush;
-    uint8_t redraw;
+    uint8_t origin;
+    uint8_t gap;
+    uint8_t step;
 
     tycho_state_t state;
 
     struct {
         unsigned ctx;
         tycho_model_t model;
-    } count, color[3];
+    } count, block, slot, run, span, color[3];
 
     struct {
         tycho_model_t model[COLOR_MAX];
     } index;
 
     tycho_coder_t coder;
+    tycho_cache_t cache;
+
+    buffer_t buffer;
+};
+
+struct tycho {
+    tycho_tiles_t tiles;
+    uint32_t *gen;
+
+    unsigned serial;
+    unsigned sync;
+
+    uint8_t created;
+    uint8_t redraw;
+    uint8_t reset;
+
+    unsigned bands;
+    unsigned coder;
+    unsigned run;
+    unsigned part;
+    tycho_band_t *band;
+
+    struct {
+        unsigned size;
+        unsigned wn;
+        unsigned count;
+        uint8_t *mode;
+    } block;
+
+    struct {
+        int x, y, w, h;
+        int dx, dy;
+        image_info_t image;
+    } move;
+
+    struct {
+        unsigned size;
+        uint8_t use;
+    } cache;
+
+    struct {
+        unsigned drop;
+        unsigned skip;
+        unsigned limit;
+    } quality;
+
+    image_info_t *image;
+
+    struct {
+        tycho_frame_t *frame;
+        buffer_t read;
+    } output;
 };
 
 void tycho_create       (tycho_t *);
 void tycho_delete       (tycho_t *);
-void tycho_setup        (tycho_t *, unsigned, unsigned);
+void tycho_setup        (tycho_t *, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned);
+void tycho_setup_bands  (tycho_t *, unsigned, unsigned, unsigned, unsigned, unsigned);
+void tycho_reset        (tycho_t *);
 void tycho_tiles_create (tycho_tiles_t *, unsigned, unsigned);
 void tycho_tiles_delete (tycho_tiles_t *);
+int  tycho_tiles_setup  (tycho_tiles_t *, unsigned, unsigned);
 int  tycho_tiles_resize (tycho_tiles_t *, unsigned, unsigned);
 void tycho_tiles_copy   (tycho_tiles_t *, tycho_tiles_t *);
-void tycho_model_create (tycho_model_t *, unsigned, unsigned);
+void tycho_model_create (tycho_model_t *, unsigned, unsigned, unsigned);
+void tycho_model_reset  (tycho_model_t *);
 void tycho_model_delete (tycho_model_t *);
+void tycho_cache_stat   (tycho_t *, unsigned *, unsigned *);
+
+tycho_frame_t *tycho_frame_create  (size_t);
+tycho_frame_t *tycho_frame_release (tycho_frame_t *);
@@ -0,0 +1,234 @@
+#include "worker.h"
+
+#if defined(_WIN32) || defined(__EMSCRIPTEN__)
+#define WORKER_NO_THREAD
+#endif
+
+#ifndef WORKER_NO_THREAD
+#include <pthread.h>
+#endif
+
+static struct worker_global {
+    unsigned count;
+#ifndef WORKER_NO_THREAD
+    pthread_mutex_t mutex;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    worker_func_t func;
+    void *data;
+    unsigned size;
+    unsigned next;
+    unsigned finished;
+    unsigned serial;
+    struct {
+        pthread_t thread;
+        pthread_cond_t start;
+        pthread_cond_t done;
+        worker_func_t func;
+        void *data;
+        unsigned size;
+        int created;
+    } async;
+#endif
+} global = {
+    .count = 1,
+};
+
+#ifndef WORKER_NO_THREAD
+static void
+worker_loop(void)
+{
+    while (global.next < global.size) {
+        const worker_func_t func = global.func;
+        void *const data = global.data;
+        const unsigned i = global.next++;
+
+        pthread_mutex_unlock(&global.mutex);
+        func(data, i);
+        pthread_mutex_lock(&global.mutex);
+
+        if (++global.finished == global.size)
+            pthread_cond_signal(&global.done);
+    }
+}
+
+static void *
+worker_main(_unused_ void *arg)
+{
+    unsigned serial = 0;
+
+    pthread_mutex_lock(&global.mutex);
+
+    while (1) {
+        while (serial == global.serial)
+            pthread_cond_wait(&global.work, &global.mutex);
+
+        serial = global.serial;
+        worker_loop();
+    }
+
+    return NULL;
+}
+
+static void *
+worker_async(_unused_ void *arg)
+{
+    pthread_mutex_lock(&global.mutex);
+
+    while (1) {
+        while (!global.async.func)
+            pthread_cond_wait(&global.async.start, &global.mutex);
+
+        const worker_func_t func = global.async.func;
+        void *const data = global.async.data;
+        const unsigned size = global.async.size;
+
+        pthread_mutex_unlock(&global.mutex);
+        worker_run(func, data, size);
+        pthread_mutex_lock(&global.mutex);
+
+        global.async.func = NULL;
+        pthread_cond_broadcast(&global.async.done);
+    }
+
+    return NULL;
+}
+#endif
+
+void
+worker_init(unsigned count)
+{
+    if (global.count > 1)
+        return;
+
+#ifdef WORKER_NO_THREAD
+    (void)count;
+#else
+    if (!count) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        count = ncpu > 0 ? ncpu : 1;
+    }
+
+    pthread_mutex_init(&global.mutex, NULL);
+    pthread_cond_init(&global.work, NULL);
+    pthread_cond_init(&global.done, NULL);
+    pthread_cond_init(&global.async.start, NULL);
+    pthread_cond_init(&global.async.done, NULL);
+
+    for (unsigned i = 1; i < count; i++) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, worker_main, NULL)) {
+            warning("couldn't create worker thread\n");
+            break;
+        }
+
+        pthread_detach(thread);
+        global.count++;
+    }
+#endif
+}
+
+unsigned
+worker_count(void)
+{
+    return global.count;
+}
+
+void
+worker_run(worker_func_t func, void *data, unsigned size)
+{
+    if (!func)
+        return;
+
+#ifndef WORKER_NO_THREAD
+    if (global.count > 1 && size > 1) {
+        pthread_mutex_lock(&global.mutex);
+
+        global.func = func;
+        global.data = data;
+        global.size = size;
+        global.next = 0;
+        global.finished = 0;
+        global.serial++;
+
+        pthread_cond_broadcast(&global.work);
+
+        worker_loop();
+
+        while (global.finished < global.size)
+            pthread_cond_wait(&global.done, &global.mutex);
+
+        pthread_mutex_unlock(&global.mutex);
+        return;
+    }
+#endif
+
+    for (unsigned i = 0; i < size; i++)
+        func(data, i);
+}
+
+void
+worker_start(worker_func_t func, void *data, unsigned size)
+{
+    if (!func)
+        return;
+
+#ifndef WORKER_NO_THREAD
+    if (!global.async.created) {
+        if (pthread_create(&global.async.thread, NULL, worker_async, NULL)) {
+            warning("couldn't create async worker thread\n");
+            global.async.created = -1;
+        } else {
+            pthread_detach(global.async.thread);
+            global.async.created = 1;
+        }
+    }
+
+    if (global.async.created == 1) {
+        worker_wait();
+
+        pthread_mutex_lock(&global.mutex);
+
+        global.async.func = func;
+        global.async.data = data;
+        global.async.size = size;
+
+        pthread_cond_signal(&global.async.start);
+        pthread_mutex_unlock(&global.mutex);
+        return;
+    }
+#endif
+
+    worker_run(func, data, size);
+}
+
+int
+worker_busy(void)
+{
+#ifndef WORKER_NO_THREAD
+    if (global.async.created == 1) {
+        pthread_mutex_lock(&global.mutex);
+        const int busy = !!global.async.func;
+        pthread_mutex_unlock(&global.mutex);
+        return busy;
+    }
+#endif
+
+    return 0;
+}
+
+void
+worker_wait(void)
+{
+#ifndef WORKER_NO_THREAD
+    if (global.async.created == 1) {
+        pthread_mutex_lock(&global.mutex);
+
+        while (global.async.func)
+            pthread_cond_wait(&global.async.done, &global.mutex);
+
+        pthread_mutex_unlock(&global.mutex);
+    }
+#endif
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "common.h"
+
+typedef void (*worker_func_t) (void *, unsigned);
+
+void     worker_init  (unsigned);
+unsigned worker_count (void);
+void     worker_run   (worker_func_t, void *, unsigned);
+void     worker_start (worker_func_t, void *, unsigned);
+int      worker_busy  (void);
+void     worker_wait  (void);
@@ -5,6 +5,7 @@
 static struct xdamage_global {
     int use;
     int event;
+    int pending;
     Damage damage;
 } global;
 
@@ -37,13 +38,32 @@ xdamage_event(XEvent *event)
     if (event->type != global.event + XDamageNotify)
         return 0;
 
-    _unused_
-    XDamageNotifyEvent *ev = (XDamageNotifyEvent *)event;
+    global.pending = 1;
+
+    return 1;
+}
+
+int
+xdamage_get(XRectangle **rects)
+{
+    if (!global.use)
+        return -1;
+
+    if (!global.pending)
+        return 0;
+
+    global.pending = 0;
 
     XserverRegion region = XFixesCreateRegion(display.id, 0, 0);
     XDamageSubtract(display.id, global.damage, None, region);
 
+    int count = 0;
+    *rects = XFixesFetchRegion(display.id, region, &count);
+
     XFixesDestroyRegion(display.id, region);
 
-    return 1;
+    if (!*rects)
+        return 0;
+
+    return count;
 }
@@ -4,3 +4,4 @@
 
 void xdamage_init  (void);
 int  xdamage_event (XEvent *);
+int  xdamage_get   (XRectangle **);